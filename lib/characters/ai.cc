@@ -0,0 +1,238 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "characters/ai.h"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "core/common.h"
+#include "maps/map.h"
+
+// How long (in milliseconds) an entity stands around before patrolling.
+static const uint32_t IDLE_TIME = 3000;
+
+// How long (in milliseconds) an entity keeps chasing after losing sight of the player.
+static const uint32_t LOSE_SIGHT_TIME = 4000;
+
+// How far (in pixels) an entity runs from the player at a time.
+static const float FLEE_DISTANCE = 8 * MAP_TILE_SIZE;
+
+// Fleeing entities calm down once the player is this many times the aggro radius away.
+static const float FLEE_SAFE_FACTOR = 2.0f;
+
+AI::AI(Map& map, Components& components, Entity& player)
+  : m_map(map)
+  , m_components(components)
+  , m_player(player)
+  , m_frame(0)
+  , m_stats()
+{
+}
+
+void AI::reset(Entity* entity)
+{
+    const auto i = entity->component_index();
+
+    auto& behavior = m_components.behavior;
+
+    behavior.state[i]       = IDLE;
+    behavior.home_x[i]      = entity->center_x();
+    behavior.home_y[i]      = entity->center_y();
+    behavior.state_start[i] = SDL_GetTicks();
+    behavior.last_seen[i]   = 0;
+}
+
+void AI::update()
+{
+    const auto start = std::chrono::steady_clock::now();
+    const auto now   = SDL_GetTicks();
+
+    m_stats.entities = 0;
+    m_thinkers.clear();
+
+    // Pick the entities whose turn it is.
+    for (uint32_t i = 0; i < m_components.size(); ++i) {
+        const auto entity = m_components.owner(i);
+
+        // Dormant entities are too far away to matter (see Map::update()).
+        if (entity->is_player() || entity->dead() || m_components.detail.tier[i] == Components::DORMANT) {
+            continue;
+        }
+
+        ++m_stats.entities;
+
+        if (const auto interval = entity->archetype().ai.think_interval; (m_frame + i) % interval == 0) {
+            m_thinkers.push_back(entity);
+        }
+    }
+
+    // Looking for the player is the costly part, so it is done at once for the entities close
+    // enough to care (the rest cannot see that far).
+    m_watchers.clear();
+
+    for (auto entity : m_thinkers) {
+        const auto& type = entity->archetype().ai;
+
+        const auto dx = m_player.center_x() - entity->center_x();
+        const auto dy = m_player.center_y() - entity->center_y();
+
+        if (const auto range = std::max(type.aggro_radius, type.leash_radius); dx * dx + dy * dy <= range * range) {
+            m_watchers.push_back(entity);
+        }
+    }
+
+    m_map.line_of_sight(m_player.center_x(), m_player.center_y(), m_watchers, m_visible);
+
+    for (size_t i = 0, watcher = 0; i < m_thinkers.size(); ++i) {
+        // The watchers are in the same order as the thinkers.
+        auto visible = false;
+
+        if (watcher < m_watchers.size() && m_watchers[watcher] == m_thinkers[i]) {
+            visible = m_visible[watcher++];
+        }
+
+        think(m_thinkers[i], visible, now);
+    }
+
+    ++m_frame;
+
+    m_stats.thinks   = m_thinkers.size();
+    m_stats.think_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+AI::State AI::state(const Entity* entity) const
+{
+    return static_cast<State>(m_components.behavior.state[entity->component_index()]);
+}
+
+const AI::Stats& AI::stats() const
+{
+    return m_stats;
+}
+
+void AI::think(Entity* entity, bool visible, uint32_t now)
+{
+    const auto  i    = entity->component_index();
+    const auto& type = entity->archetype().ai;
+
+    auto& behavior = m_components.behavior;
+
+    const auto distance =
+      std::hypot(m_player.center_x() - entity->center_x(), m_player.center_y() - entity->center_y());
+    const auto home_distance =
+      std::hypot(entity->center_x() - behavior.home_x[i], entity->center_y() - behavior.home_y[i]);
+
+    if (visible) {
+        behavior.last_seen[i] = now;
+    }
+
+    const auto sees_player = visible && distance <= type.aggro_radius;
+    const auto hurt        = entity->health() < type.flee_health * entity->max_health();
+
+    switch (behavior.state[i]) {
+    case IDLE:
+        if (sees_player) {
+            enter(entity, CHASE, now);
+            entity->chase(&m_player);
+        } else if (type.patrol_radius > 0 && !entity->walking() && now - behavior.state_start[i] >= IDLE_TIME) {
+            enter(entity, PATROL, now);
+            patrol(entity);
+        }
+        break;
+    case PATROL:
+        if (sees_player) {
+            enter(entity, CHASE, now);
+            entity->chase(&m_player);
+        } else if (!entity->walking()) {
+            enter(entity, IDLE, now);
+        }
+        break;
+    case CHASE:
+        if (hurt) {
+            enter(entity, FLEE, now);
+            flee(entity);
+        } else if (home_distance > type.leash_radius || now - behavior.last_seen[i] > LOSE_SIGHT_TIME) {
+            return_home(entity, now);
+        } else if (entity->is_near_entity(&m_player)) {
+            enter(entity, ATTACK, now);
+            entity->attack(&m_player);
+        } else {
+            entity->chase(&m_player);
+        }
+        break;
+    case ATTACK:
+        if (hurt) {
+            entity->stop_attacking();
+
+            enter(entity, FLEE, now);
+            flee(entity);
+        } else if (!entity->attacking()) {
+            // The player walked away.
+            enter(entity, CHASE, now);
+            entity->chase(&m_player);
+        }
+        break;
+    case FLEE:
+        if (distance > type.aggro_radius * FLEE_SAFE_FACTOR) {
+            enter(entity, IDLE, now);
+        } else if (!entity->walking()) {
+            flee(entity);
+        }
+        break;
+    }
+}
+
+void AI::enter(Entity* entity, State state, uint32_t now)
+{
+    const auto i = entity->component_index();
+
+    m_components.behavior.state[i]       = state;
+    m_components.behavior.state_start[i] = now;
+}
+
+void AI::return_home(Entity* entity, uint32_t now)
+{
+    const auto i = entity->component_index();
+
+    enter(entity, IDLE, now);
+
+    entity->walk_to_position(m_components.behavior.home_x[i], m_components.behavior.home_y[i]);
+}
+
+void AI::patrol(Entity* entity)
+{
+    const auto i      = entity->component_index();
+    const auto radius = entity->archetype().ai.patrol_radius;
+
+    const auto x = m_components.behavior.home_x[i] + (rand() % (2 * radius + 1) - radius) * MAP_TILE_SIZE;
+    const auto y = m_components.behavior.home_y[i] + (rand() % (2 * radius + 1) - radius) * MAP_TILE_SIZE;
+
+    // The path ends next to the spot if it is blocked.
+    entity->walk_to_position(std::clamp(x, 0.0f, MAP_WIDTH - 1.0f), std::clamp(y, 0.0f, MAP_HEIGHT - 1.0f));
+}
+
+void AI::flee(Entity* entity)
+{
+    auto dx = entity->center_x() - m_player.center_x();
+    auto dy = entity->center_y() - m_player.center_y();
+
+    // Standing right on the player, any way will do.
+    if (const auto length = std::hypot(dx, dy); length > 0.0f) {
+        dx /= length;
+        dy /= length;
+    } else {
+        dx = 1.0f;
+        dy = 0.0f;
+    }
+
+    const auto x = entity->center_x() + dx * FLEE_DISTANCE;
+    const auto y = entity->center_y() + dy * FLEE_DISTANCE;
+
+    entity->walk_to_position(std::clamp(x, 0.0f, MAP_WIDTH - 1.0f), std::clamp(y, 0.0f, MAP_HEIGHT - 1.0f));
+}
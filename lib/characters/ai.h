@@ -0,0 +1,97 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "characters/components.h"
+#include "characters/entity.h"
+
+class Map;
+
+// AI drives the enemies with a small state machine per entity:
+//
+//   IDLE   -> PATROL  after standing around for a while (if the archetype patrols)
+//   IDLE   -> CHASE   on seeing the player within the aggro radius
+//   PATROL -> CHASE   on seeing the player, back to IDLE once the patrol point is reached
+//   CHASE  -> ATTACK  once next to the player
+//   CHASE  -> IDLE    when too far from home or after losing sight of the player (walks home)
+//   ATTACK -> CHASE   once the player walks away
+//   CHASE  -> FLEE    on low health (if the archetype flees), back to IDLE once far enough away
+//
+// Deciding is much more expensive than moving (it looks for the player and may search for
+// paths), so an entity only thinks every few frames while its movement still runs every tick.
+// The thinking is staggered by the entity's slot so that the same share of the enemies thinks
+// on every frame.
+class AI
+{
+public:
+    // The state of an entity.
+    enum State : uint8_t
+    {
+        IDLE   = 0,
+        PATROL = 1,
+        CHASE  = 2,
+        ATTACK = 3,
+        FLEE   = 4,
+    };
+
+    // Counters from the last frame.
+    struct Stats
+    {
+        int    entities;
+        int    thinks;
+        double think_us;
+    };
+
+public:
+    // Create the AI of the enemies on a map.
+    explicit AI(Map& map, Components& components, Entity& player);
+
+public:
+    // Put an entity in the idle state and make its current position its home.
+    void reset(Entity* entity);
+
+    // Let the entities scheduled for this frame think.
+    void update();
+
+    // Return the state of an entity.
+    State state(const Entity* entity) const;
+
+    // Return the counters from the last frame.
+    const Stats& stats() const;
+
+private:
+    // Decide what an entity does next.
+    void think(Entity* entity, bool visible, uint32_t now);
+
+    // Switch an entity to another state.
+    void enter(Entity* entity, State state, uint32_t now);
+
+    // Walk back home.
+    void return_home(Entity* entity, uint32_t now);
+
+    // Walk to a random free spot around home.
+    void patrol(Entity* entity);
+
+    // Run directly away from the player.
+    void flee(Entity* entity);
+
+private:
+    Map&        m_map;
+    Components& m_components;
+    Entity&     m_player;
+
+    uint32_t m_frame;
+    Stats    m_stats;
+
+    // The entities thinking on this frame, the ones close enough to the player to look for it and
+    // whether they can see it.
+    std::vector<Entity*> m_thinkers;
+    std::vector<Entity*> m_watchers;
+    std::vector<uint8_t> m_visible;
+};
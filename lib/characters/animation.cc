@@ -0,0 +1,69 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "characters/animation.h"
+
+#include "core/game.h"
+
+// The number of footstep sounds (FOOTSTEP00 to FOOTSTEP09).
+static const int FOOTSTEP_COUNT = 10;
+
+AnimationEvents::AnimationEvents(Game& game)
+  : m_game(game)
+  , m_footstep(0)
+  , m_stats()
+{
+}
+
+void AnimationEvents::push(Handle entity, AnimationEvent::Type type)
+{
+    m_events.push_back({ entity, type });
+}
+
+void AnimationEvents::dispatch()
+{
+    m_stats = {};
+
+    auto footstep = false;
+
+    for (const auto& event : m_events) {
+        auto entity = m_game.map.entity(event.entity);
+
+        if (entity == nullptr || entity->dead()) {
+            continue;
+        }
+
+        switch (event.type) {
+        case AnimationEvent::FOOTSTEP:
+            // Only the steps that can be seen are heard.
+            if (entity->is_player() || m_game.map.on_screen(entity)) {
+                footstep = true;
+                ++m_stats.footsteps;
+            }
+            break;
+        case AnimationEvent::HIT:
+            // The attack may have been called off since the event fired.
+            if (entity->attacking()) {
+                entity->strike();
+                ++m_stats.hits;
+            }
+            break;
+        }
+    }
+
+    m_events.clear();
+
+    // One step for the whole batch (however many feet touched the ground).
+    if (footstep) {
+        m_game.audio.play_sound(static_cast<Audio::Sound>(Audio::Sound::FOOTSTEP00 + m_footstep), 0);
+
+        m_footstep = (m_footstep + 1) % FOOTSTEP_COUNT;
+    }
+}
+
+const AnimationEvents::Stats& AnimationEvents::stats() const
+{
+    return m_stats;
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/slot_map.h"
+
+class Game;
+
+// An event fired when an animation reaches one of its frames (ex. a footstep on the frames where
+// a foot touches the ground or the hit on the frame where the blade comes down).
+struct AnimationEvent
+{
+    enum Type : uint8_t
+    {
+        FOOTSTEP,
+        HIT,
+    };
+
+    // The animations of a sprite sheet (whatever the direction).
+    enum Animation : uint8_t
+    {
+        OPEN_ARMS,
+        SPEAR_ATTACK,
+        WALK,
+        SLASH,
+        ARROW_ATTACK,
+        FALL,
+        WIDE_SLASH,
+        ANIMATION_COUNT,
+    };
+
+    // The number of frames of each animation on the sprite sheets.
+    static constexpr uint8_t FRAME_COUNTS[ANIMATION_COUNT] = { 7, 8, 9, 6, 13, 6, 6 };
+
+    Type    type;
+    uint8_t frame;
+};
+
+// AnimationEvents collects the events fired by the entities while they are updated and
+// dispatches them together once every entity has been updated (in the order they were fired).
+class AnimationEvents
+{
+public:
+    // Counters from the last dispatch.
+    struct Stats
+    {
+        int footsteps;
+        int hits;
+    };
+
+public:
+    // Create an empty queue for the game.
+    explicit AnimationEvents(Game& game);
+
+public:
+    // Queue an event fired by an entity.
+    void push(Handle entity, AnimationEvent::Type type);
+
+    // Dispatch the events queued since the last dispatch.
+    void dispatch();
+
+    // Return the counters from the last dispatch.
+    const Stats& stats() const;
+
+private:
+    struct Fired
+    {
+        Handle               entity;
+        AnimationEvent::Type type;
+    };
+
+private:
+    Game& m_game;
+
+    std::vector<Fired> m_events;
+
+    // The next footstep sound (they take turns so that walking does not sound the same).
+    int m_footstep;
+
+    Stats m_stats;
+};
@@ -0,0 +1,301 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "characters/archetype.h"
+
+#include <rapidjson/document.h>
+#include <rapidjson/istreamwrapper.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+#include "core/common.h"
+#include "core/logger.h"
+
+// Read a number member of a JSON object.
+template<typename T>
+static bool read_number(const rapidjson::Value& object, const char* name, T& value, const std::string& path)
+{
+    const auto integral = std::is_integral_v<T>;
+
+    if (!object.IsObject() || !object.HasMember(name)
+        || !(integral ? object[name].IsInt() : object[name].IsNumber())) {
+        LOG_ERROR << "Missing number in archetype definition: " << path << " (" << name << ")" << std::endl;
+        return false;
+    }
+
+    if constexpr (integral) {
+        value = object[name].GetInt();
+    } else {
+        value = object[name].GetFloat();
+    }
+
+    return true;
+}
+
+// Read a string member of a JSON object.
+static bool read_string(const rapidjson::Value& object, const char* name, std::string& value, const std::string& path)
+{
+    if (!object.IsObject() || !object.HasMember(name) || !object[name].IsString()) {
+        LOG_ERROR << "Missing string in archetype definition: " << path << " (" << name << ")" << std::endl;
+        return false;
+    }
+
+    value = object[name].GetString();
+
+    return true;
+}
+
+// The names of the animations and of the events in the definitions (in enum order).
+static const char* ANIMATION_NAMES[] = { "open_arms", "spear_attack", "walk", "slash", "arrow_attack", "fall",
+                                         "wide_slash" };
+static const char* EVENT_NAMES[]     = { "footstep", "hit" };
+
+// Return the position of a name in a table or -1 if it is not there.
+template<size_t N>
+static int find_name(const char* (&names)[N], const std::string& name)
+{
+    for (size_t i = 0; i < N; ++i) {
+        if (name == names[i]) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+// Return the member of a JSON object or the object itself if there is no such member (so that
+// reading from it reports the missing fields).
+static const rapidjson::Value& member(const rapidjson::Value& object, const char* name)
+{
+    return object.HasMember(name) ? object[name] : object;
+}
+
+// Read the events of the animations (sorted by frame).
+static bool read_tracks(const rapidjson::Value& animation, const std::string& path, Archetype& archetype)
+{
+    // Without events the animations only change the sprites.
+    if (!animation.IsObject() || !animation.HasMember("events")) {
+        return true;
+    }
+
+    if (!animation["events"].IsArray()) {
+        LOG_ERROR << "Invalid animation events in archetype definition: " << path << std::endl;
+        return false;
+    }
+
+    for (const auto& event : animation["events"].GetArray()) {
+        std::string name;
+        std::string type;
+        int         frame = 0;
+
+        if (!read_string(event, "animation", name, path) || !read_string(event, "type", type, path)
+            || !read_number(event, "frame", frame, path)) {
+            return false;
+        }
+
+        const auto index = find_name(ANIMATION_NAMES, name);
+        const auto kind  = find_name(EVENT_NAMES, type);
+
+        // A frame past the end of the animation would never be reached (and its event never fired).
+        if (index == -1 || kind == -1 || frame < 0 || frame >= AnimationEvent::FRAME_COUNTS[index]) {
+            LOG_ERROR << "Invalid animation event in archetype definition: " << path << " (" << name << " " << type
+                      << " " << frame << ")" << std::endl;
+            return false;
+        }
+
+        archetype.tracks[index].push_back({ static_cast<AnimationEvent::Type>(kind), static_cast<uint8_t>(frame) });
+    }
+
+    for (auto& track : archetype.tracks) {
+        std::stable_sort(track.begin(), track.end(), [](const auto& a, const auto& b) {
+            return a.frame < b.frame;
+        });
+    }
+
+    return true;
+}
+
+Archetypes::Archetypes()
+{
+}
+
+bool Archetypes::load(const std::string& directory)
+{
+    std::error_code          error;
+    std::vector<std::string> paths;
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".json") {
+            paths.push_back(entry.path().string());
+        }
+    }
+
+    if (error) {
+        LOG_ERROR << "Failed to list archetype definitions: " << directory << " (" << error.message() << ")"
+                  << std::endl;
+        return false;
+    }
+
+    // The same table whatever order the directory is listed in.
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<Archetype> archetypes(paths.size());
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (!parse(paths[i], archetypes[i])) {
+            return false;
+        }
+    }
+
+    std::sort(archetypes.begin(), archetypes.end(), [](const auto& a, const auto& b) {
+        return a.id < b.id;
+    });
+
+    std::vector<int16_t> positions(MAX_ID + 1, -1);
+
+    for (size_t i = 0; i < archetypes.size(); ++i) {
+        if (positions[archetypes[i].id] != -1) {
+            LOG_ERROR << "Archetype defined twice: " << archetypes[i].id << std::endl;
+            return false;
+        }
+
+        positions[archetypes[i].id] = i;
+    }
+
+    m_archetypes = std::move(archetypes);
+    m_positions  = std::move(positions);
+
+    LOG_DEBUG << "Loaded archetypes: " << m_archetypes.size() << std::endl;
+
+    return true;
+}
+
+const Archetype* Archetypes::find(int id) const
+{
+    if (id < 0 || id >= static_cast<int>(m_positions.size()) || m_positions[id] == -1) {
+        return nullptr;
+    }
+
+    return &m_archetypes[m_positions[id]];
+}
+
+size_t Archetypes::size() const
+{
+    return m_archetypes.size();
+}
+
+bool Archetypes::parse(const std::string& path, Archetype& archetype)
+{
+    std::ifstream file(path);
+
+    if (!file.is_open()) {
+        LOG_ERROR << "Failed to open archetype definition: " << path << std::endl;
+        return false;
+    }
+
+    rapidjson::IStreamWrapper isw(file);
+    rapidjson::Document       doc;
+
+    doc.ParseStream(isw);
+
+    if (doc.HasParseError() || !doc.IsObject()) {
+        LOG_ERROR << "Failed to parse archetype definition: " << path << std::endl;
+        return false;
+    }
+
+    const auto& stats     = member(doc, "stats");
+    const auto& range     = member(doc, "attack_range");
+    const auto& animation = member(doc, "animation");
+
+    int ground_rate = 0;
+    int jump_rate   = 0;
+
+    if (!read_number(doc, "id", archetype.id, path) || !read_string(doc, "name", archetype.name, path)
+        || !read_string(doc, "sprite_sheet", archetype.sprite_sheet, path)
+        || !read_number(stats, "health", archetype.health, path) || !read_number(stats, "mana", archetype.mana, path)
+        || !read_number(stats, "stamina", archetype.stamina, path)
+        || !read_number(stats, "attack_power", archetype.attack_power, path)
+        || !read_number(stats, "speed", archetype.speed, path)
+        || !read_number(stats, "max_speed", archetype.max_speed, path)
+        || !read_number(range, "short", archetype.attack_short_range, path)
+        || !read_number(range, "long", archetype.attack_long_range, path)
+        || !read_number(animation, "ground_rate", ground_rate, path)
+        || !read_number(animation, "jump_rate", jump_rate, path)) {
+        return false;
+    }
+
+    if (archetype.id < 0 || archetype.id > MAX_ID) {
+        LOG_ERROR << "Archetype id out of range: " << path << " (" << archetype.id << ")" << std::endl;
+        return false;
+    }
+
+    // The attack damage is a random number below the attack power (which cannot be 0).
+    if (archetype.attack_power <= 0 || ground_rate <= 0 || jump_rate <= 0) {
+        LOG_ERROR << "Invalid archetype definition: " << path << std::endl;
+        return false;
+    }
+
+    archetype.ground_animation_rate = ground_rate;
+    archetype.jump_animation_rate   = jump_rate;
+
+    for (auto& track : archetype.tracks) {
+        track.clear();
+    }
+
+    if (!read_tracks(animation, path, archetype)) {
+        return false;
+    }
+
+    archetype.skills.clear();
+
+    if (doc.HasMember("skills")) {
+        if (!doc["skills"].IsArray()) {
+            LOG_ERROR << "Invalid skills in archetype definition: " << path << std::endl;
+            return false;
+        }
+
+        for (const auto& skill : doc["skills"].GetArray()) {
+            int type  = 0;
+            int count = 0;
+
+            if (!read_number(skill, "type", type, path) || !read_number(skill, "count", count, path)) {
+                return false;
+            }
+
+            // The type is also the icon of the skill.
+            if (type < 0 || type >= ICON_COUNT) {
+                LOG_ERROR << "Invalid skill in archetype definition: " << path << " (" << type << ")" << std::endl;
+                return false;
+            }
+
+            archetype.skills.push_back(Skill(static_cast<Skill::Type>(type), count));
+        }
+    }
+
+    // Without an AI profile the entity never notices anyone.
+    archetype.ai = { 1, 0.0f, 0.0f, 0.0f, 0 };
+
+    if (doc.HasMember("ai")) {
+        const auto& ai = doc["ai"];
+
+        // The radii are given in tiles.
+        if (!read_number(ai, "think_interval", archetype.ai.think_interval, path)
+            || !read_number(ai, "aggro_radius", archetype.ai.aggro_radius, path)
+            || !read_number(ai, "leash_radius", archetype.ai.leash_radius, path)
+            || !read_number(ai, "flee_health", archetype.ai.flee_health, path)
+            || !read_number(ai, "patrol_radius", archetype.ai.patrol_radius, path)) {
+            return false;
+        }
+
+        archetype.ai.think_interval = std::max(1, archetype.ai.think_interval);
+        archetype.ai.aggro_radius *= MAP_TILE_SIZE;
+        archetype.ai.leash_radius *= MAP_TILE_SIZE;
+    }
+
+    return true;
+}
@@ -0,0 +1,106 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "characters/animation.h"
+#include "characters/skill.h"
+
+// How an archetype behaves when driven by the AI.
+struct AIProfile
+{
+    // The number of frames between two thinks.
+    int think_interval;
+
+    // How close (in pixels) the player has to be to be noticed.
+    float aggro_radius;
+
+    // How far (in pixels) the entity follows the player away from home.
+    float leash_radius;
+
+    // The share of health below which the entity runs away (0 never).
+    float flee_health;
+
+    // How far (in tiles) from home the entity patrols (0 never).
+    int patrol_radius;
+};
+
+// Archetype holds everything the entities of one kind have in common. It is defined in a file of
+// data/definitions and shared by every entity of that kind, which only keeps its own state.
+struct Archetype
+{
+    // The id of the archetype (the type of the objects placed on the maps).
+    int id;
+
+    // The name of the archetype (for the logs).
+    std::string name;
+
+    // The sprite sheet (relative to the resource folder).
+    std::string sprite_sheet;
+
+    int   health;
+    int   mana;
+    int   stamina;
+    int   attack_power;
+    float speed;
+    float max_speed;
+
+    // The attack ranges (in tiles).
+    int attack_short_range;
+    int attack_long_range;
+
+    // The animation rates (in frames per second) on the ground and in the air.
+    uint16_t ground_animation_rate;
+    uint16_t jump_animation_rate;
+
+    // The events of each animation (in frame order).
+    std::vector<AnimationEvent> tracks[AnimationEvent::ANIMATION_COUNT];
+
+    // The skills every entity starts with.
+    std::vector<Skill> skills;
+
+    AIProfile ai;
+};
+
+// Archetypes is the table of all archetypes, loaded once when the game starts.
+class Archetypes
+{
+public:
+    // The highest archetype id.
+    static const int MAX_ID = 255;
+
+    // The archetype of the player (the type of the Player objects placed on the maps).
+    static const int PLAYER_ID = 0;
+
+public:
+    // Create an empty table.
+    explicit Archetypes();
+
+    Archetypes(const Archetypes&)            = delete;
+    Archetypes& operator=(const Archetypes&) = delete;
+
+public:
+    // Load every definition (*.json) in a directory, replacing the current table.
+    bool load(const std::string& directory);
+
+    // Return the archetype with the given id or nullptr if there is none.
+    const Archetype* find(int id) const;
+
+    // Return the number of archetypes.
+    size_t size() const;
+
+private:
+    // Read one definition file.
+    static bool parse(const std::string& path, Archetype& archetype);
+
+private:
+    // The archetypes in id order and the position of each id in it (-1 if undefined).
+    std::vector<Archetype> m_archetypes;
+    std::vector<int16_t>   m_positions;
+};
@@ -0,0 +1,175 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "characters/benchmark.h"
+
+#include <rapidjson/ostreamwrapper.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "characters/components.h"
+#include "characters/movement.h"
+#include "core/common.h"
+
+using Writer = rapidjson::Writer<rapidjson::OStreamWrapper>;
+
+// The numbers of entities.
+static const int ENTITY_COUNTS[] = { 1000, 10000, 100000 };
+
+// The time between steps (in seconds, about 60 fps).
+static const float STEP_TIME = 0.016f;
+
+// Each kernel runs this many times and the fastest run is kept.
+static const int REPEATS = 5;
+
+// Return a random number in [0, 1). The raw engine output is used (rather than a distribution)
+// so that the entities are the same with every standard library.
+static float random_unit(std::mt19937& rng)
+{
+    return (rng() >> 8) * (1.0f / (1 << 24));
+}
+
+// Fill the motion components of a number of entities.
+static void generate(Components::Motion& m, int count, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+
+    for (int i = 0; i < count; ++i) {
+        const auto kind = rng() % 10;
+
+        // Standing still, paused, walking or jumping.
+        const auto idle    = kind == 0;
+        const auto jumping = kind >= 8;
+
+        m.position_x.push_back(random_unit(rng) * (MAP_WIDTH - CHARACTER_WIDTH));
+        m.position_y.push_back(random_unit(rng) * (MAP_HEIGHT - CHARACTER_HEIGHT));
+        m.position_z.push_back(m.position_y.back() - (jumping ? random_unit(rng) * CHARACTER_HEIGHT : 0.0f));
+        m.velocity_x.push_back(idle ? 0.0f : (random_unit(rng) * 2 - 1) * 300);
+        m.velocity_y.push_back(idle ? 0.0f : (random_unit(rng) * 2 - 1) * 300);
+        m.velocity_z.push_back(jumping ? -random_unit(rng) * 200 : 0.0f);
+        m.acceleration_z.push_back(jumping ? 200.0f : 0.0f);
+        m.speed.push_back(12.0f);
+        m.max_speed.push_back(244.0f);
+        m.elapsed.push_back(STEP_TIME);
+        m.jumping.push_back(jumping);
+        m.paused.push_back(kind == 1);
+    }
+}
+
+// Return the largest difference between two arrays.
+static float max_difference(const std::vector<float>& a, const std::vector<float>& b)
+{
+    auto difference = 0.0f;
+
+    for (size_t i = 0; i < a.size(); ++i) {
+        difference = std::max(difference, std::abs(a[i] - b[i]));
+    }
+
+    return difference;
+}
+
+// Run a kernel over copies of the entities and return the fastest run (in nanoseconds per entity
+// and step). The motion is left as the last run moved it.
+template<typename Kernel>
+static double measure(const Components::Motion& initial, Components::Motion& motion, int steps, Kernel kernel)
+{
+    std::vector<uint32_t> landed;
+
+    auto best = 0.0;
+
+    for (int repeat = 0; repeat < REPEATS; ++repeat) {
+        motion = initial;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (int step = 0; step < steps; ++step) {
+            landed.clear();
+            kernel(motion, landed);
+        }
+
+        const auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        if (repeat == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return best / (static_cast<double>(steps) * initial.position_x.size());
+}
+
+MovementBenchmark::MovementBenchmark(uint32_t seed, int steps)
+  : m_seed(seed)
+  , m_steps(steps)
+{
+}
+
+bool MovementBenchmark::run(std::ostream& stream) const
+{
+    rapidjson::OStreamWrapper osw(stream);
+    Writer                    writer(osw);
+
+    writer.StartObject();
+    writer.Key("seed");
+    writer.Uint(m_seed);
+    writer.Key("steps");
+    writer.Int(m_steps);
+    writer.Key("isa");
+    writer.String(integrate_motion_isa());
+    writer.Key("runs");
+    writer.StartArray();
+
+    for (const auto count : ENTITY_COUNTS) {
+        Components::Motion initial;
+
+        generate(initial, count, m_seed ^ (count * 7919u));
+
+        Components::Motion scalar;
+        Components::Motion batched;
+
+        const auto scalar_time = measure(initial, scalar, m_steps, [count](auto& motion, auto& landed) {
+            integrate_motion_scalar(motion, 0, count, landed);
+        });
+
+        const auto batched_time = measure(initial, batched, m_steps, [count](auto& motion, auto& landed) {
+            integrate_motion(motion, count, landed);
+        });
+
+        const auto error = std::max({ max_difference(scalar.position_x, batched.position_x),
+                                      max_difference(scalar.position_y, batched.position_y),
+                                      max_difference(scalar.position_z, batched.position_z),
+                                      max_difference(scalar.velocity_x, batched.velocity_x),
+                                      max_difference(scalar.velocity_y, batched.velocity_y),
+                                      max_difference(scalar.velocity_z, batched.velocity_z) });
+
+        writer.StartObject();
+        writer.Key("entities");
+        writer.Int(count);
+        writer.Key("scalar_ns");
+        writer.Double(scalar_time);
+        writer.Key("batched_ns");
+        writer.Double(batched_time);
+        writer.Key("speedup");
+        writer.Double(batched_time > 0 ? scalar_time / batched_time : 0);
+        writer.Key("max_error");
+        writer.Double(error);
+        writer.Key("jumping_match");
+        writer.Bool(scalar.jumping == batched.jumping);
+        writer.EndObject();
+
+        stream.flush();
+    }
+
+    writer.EndArray();
+    writer.EndObject();
+
+    stream << std::endl;
+
+    return writer.IsComplete() && stream.good();
+}
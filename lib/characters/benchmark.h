@@ -0,0 +1,37 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// MovementBenchmark measures the movement kernels on 1,000 up to 100,000 generated entities
+// (a mix of walking, jumping, paused and idle ones). The batched kernel and the scalar kernel
+// move copies of the same entities for the same steps, and the largest difference between
+// their results is reported along with the time per entity.
+//
+// The entities only depend on the seed. The results are written as a single JSON document.
+class MovementBenchmark
+{
+public:
+    // The default seed of the entities.
+    static const uint32_t DEFAULT_SEED = 1;
+
+    // The default number of steps per run.
+    static const int DEFAULT_STEPS = 200;
+
+public:
+    // Create a new benchmark.
+    explicit MovementBenchmark(uint32_t seed = DEFAULT_SEED, int steps = DEFAULT_STEPS);
+
+public:
+    // Run every benchmark and write the results as JSON. Returns false if writing failed.
+    bool run(std::ostream& stream) const;
+
+private:
+    uint32_t m_seed;
+    int      m_steps;
+};
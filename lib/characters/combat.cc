@@ -0,0 +1,134 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "characters/combat.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "core/game.h"
+
+Combat::Combat(Game& game)
+  : m_game(game)
+  , m_stats()
+{
+}
+
+void Combat::melee(Handle source, Handle target, int amount)
+{
+    m_hits.push_back({ Hit::MELEE, source, target, 0.0f, 0.0f, 0.0f, amount });
+}
+
+void Combat::projectile(Handle source, float x, float y, int amount)
+{
+    m_hits.push_back({ Hit::PROJECTILE, source, {}, x, y, MAP_TILE_SIZE, amount });
+}
+
+void Combat::area(Handle source, float x, float y, float radius, int amount)
+{
+    m_hits.push_back({ Hit::AREA, source, {}, x, y, radius, amount });
+}
+
+void Combat::resolve()
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    m_stats = {};
+
+    // Hits added while resolving (ex. by a death) wait for the next pass.
+    std::swap(m_hits, m_resolving);
+
+    for (const auto& hit : m_resolving) {
+        const auto caster = hit.source;
+
+        switch (hit.kind) {
+        case Hit::MELEE:
+            if (!apply(hit, m_game.map.entity(hit.target))) {
+                ++m_stats.misses;
+            }
+            break;
+        case Hit::PROJECTILE: {
+            // Whoever is closest to the point of impact (the target may have moved away).
+            auto entity = m_game.map.spatial_grid().nearest(hit.x, hit.y, hit.radius, [caster](Entity* entity) {
+                return entity->handle() != caster && !entity->dead();
+            });
+
+            if (!apply(hit, entity)) {
+                ++m_stats.misses;
+            }
+            break;
+        }
+        case Hit::AREA: {
+            m_game.map.spatial_grid().query_radius(hit.x, hit.y, hit.radius, m_query_buffer);
+
+            std::sort(m_query_buffer.begin(), m_query_buffer.end(), [](const auto a, const auto b) {
+                return a->handle().index < b->handle().index;
+            });
+
+            auto landed = false;
+
+            for (auto entity : m_query_buffer) {
+                if (entity->handle() != caster && apply(hit, entity)) {
+                    landed = true;
+                }
+            }
+
+            if (!landed) {
+                ++m_stats.misses;
+            }
+            break;
+        }
+        }
+    }
+
+    m_resolving.clear();
+
+    // One sound for the whole pass (however many hits landed).
+    if (m_stats.hits > 0) {
+        m_game.audio.play_sound(Audio::Sound::KNIFE_SLICE, 0);
+    }
+
+    m_stats.resolve_us =
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Combat::clear()
+{
+    m_hits.clear();
+}
+
+const Combat::Stats& Combat::stats() const
+{
+    return m_stats;
+}
+
+bool Combat::apply(const Hit& hit, Entity* entity)
+{
+    if (entity == nullptr || entity->dead()) {
+        return false;
+    }
+
+    // Being hit wakes a far away entity up.
+    m_game.map.wake(entity);
+
+    entity->damage(hit.amount);
+
+    ++m_stats.hits;
+
+    // Scaled by damage magnitude, above the entity.
+    const auto scale = std::max(1.0f, std::min(2.0f, (static_cast<float>(hit.amount) / 100.0f) * 2.0f));
+
+    m_game.combat_text.add(hit.amount, entity->center_x(), entity->pos_z(), scale, rand() % 20);
+
+    if (entity->dead()) {
+        ++m_stats.kills;
+
+        if (auto source = m_game.map.entity(hit.source); source != nullptr && source->is_player()) {
+            m_game.dialogue.play_notice(Dialogue::Notice::ENEMY_DEFEATED);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/slot_map.h"
+
+class Game;
+class Entity;
+
+// Combat collects the hits of a tick (melee attacks, projectile impacts and area effects) and
+// resolves them together in a single pass: the damage, the deaths, the combat text, the sounds and
+// the dialogue notices. Nothing is damaged while the entities are being updated, so a hit can never
+// change an entity that has yet to be updated in the same tick.
+//
+// The hits are resolved in the order they were added and the entities of an area in handle order,
+// so the same hits always have the same outcome. An entity that is already dead (or gone) when its
+// hit comes up is not hit again.
+class Combat
+{
+public:
+    // Counters from the last pass.
+    struct Stats
+    {
+        int    hits;
+        int    misses;
+        int    kills;
+        double resolve_us;
+    };
+
+public:
+    // Create an empty queue for the game.
+    explicit Combat(Game& game);
+
+public:
+    // Hit a target with a melee attack.
+    void melee(Handle source, Handle target, int amount);
+
+    // Hit the entity closest to the point of impact of a projectile (within a tile).
+    void projectile(Handle source, float x, float y, int amount);
+
+    // Hit every entity within the radius (in pixels) of a point.
+    void area(Handle source, float x, float y, float radius, int amount);
+
+    // Resolve the hits added since the last pass.
+    void resolve();
+
+    // Drop the hits that have yet to be resolved (ex. when the level changes).
+    void clear();
+
+    // Return the counters from the last pass.
+    const Stats& stats() const;
+
+private:
+    struct Hit
+    {
+        enum Kind : uint8_t
+        {
+            MELEE,
+            PROJECTILE,
+            AREA,
+        };
+
+        Kind   kind;
+        Handle source;
+        Handle target;
+        float  x;
+        float  y;
+        float  radius;
+        int    amount;
+    };
+
+    // Apply the damage of a hit to an entity. Returns false if the entity was already dead.
+    bool apply(const Hit& hit, Entity* entity);
+
+private:
+    Game& m_game;
+
+    // The hits to resolve and the ones added while resolving (for the next pass).
+    std::vector<Hit> m_hits;
+    std::vector<Hit> m_resolving;
+
+    std::vector<Entity*> m_query_buffer;
+
+    Stats m_stats;
+};
@@ -0,0 +1,141 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "characters/components.h"
+
+#include "characters/entity.h"
+#include "characters/movement.h"
+
+// Call a function with every array of the components.
+template<typename Function>
+static void for_each_array(Components& components, Function function)
+{
+    auto& motion = components.motion;
+
+    function(motion.position_x);
+    function(motion.position_y);
+    function(motion.position_z);
+    function(motion.velocity_x);
+    function(motion.velocity_y);
+    function(motion.velocity_z);
+    function(motion.acceleration_z);
+    function(motion.speed);
+    function(motion.max_speed);
+    function(motion.elapsed);
+    function(motion.jumping);
+    function(motion.paused);
+
+    auto& animation = components.animation;
+
+    function(animation.state);
+    function(animation.frame);
+    function(animation.rate);
+    function(animation.start);
+    function(animation.playing);
+    function(animation.fired);
+
+    auto& stats = components.stats;
+
+    function(stats.health);
+    function(stats.max_health);
+    function(stats.mana);
+    function(stats.max_mana);
+    function(stats.stamina);
+    function(stats.max_stamina);
+    function(stats.attack_power);
+
+    function(components.render.texture);
+    function(components.render.frame);
+
+    auto& behavior = components.behavior;
+
+    function(behavior.state);
+    function(behavior.home_x);
+    function(behavior.home_y);
+    function(behavior.state_start);
+    function(behavior.last_seen);
+
+    auto& detail = components.detail;
+
+    function(detail.tier);
+    function(detail.pending);
+    function(detail.awake_until);
+}
+
+Components::Components()
+{
+}
+
+uint32_t Components::add(Entity* owner)
+{
+    const auto index = static_cast<uint32_t>(m_owners.size());
+
+    m_owners.push_back(owner);
+
+    for_each_array(*this, [](auto& array) {
+        array.emplace_back();
+    });
+
+    return index;
+}
+
+void Components::remove(uint32_t index)
+{
+    const auto last = static_cast<uint32_t>(m_owners.size() - 1);
+
+    // Keep the arrays packed by moving the last slot into the hole.
+    if (index != last) {
+        for_each_array(*this, [index, last](auto& array) {
+            array[index] = array[last];
+        });
+
+        m_owners[index] = m_owners[last];
+        m_owners[index]->set_component_index(index);
+    }
+
+    for_each_array(*this, [](auto& array) {
+        array.pop_back();
+    });
+
+    m_owners.pop_back();
+}
+
+size_t Components::size() const
+{
+    return m_owners.size();
+}
+
+Entity* Components::owner(uint32_t index) const
+{
+    return m_owners[index];
+}
+
+void Components::integrate()
+{
+    m_landed.clear();
+
+    integrate_motion(motion, m_owners.size(), m_landed);
+
+    // Back on the ground after a jump.
+    for (auto i : m_landed) {
+        animation.frame[i] = 0;
+        animation.rate[i]  = m_owners[i]->archetype().ground_animation_rate;
+
+        if (motion.velocity_x[i] == 0.0f && motion.velocity_y[i] == 0.0f) {
+            animation.playing[i] = false;
+        }
+    }
+}
+
+size_t Components::memory_usage() const
+{
+    size_t bytes = m_owners.capacity() * sizeof(Entity*) + m_landed.capacity() * sizeof(uint32_t);
+
+    for_each_array(const_cast<Components&>(*this), [&bytes](auto& array) {
+        bytes += array.capacity() * sizeof(array[0]);
+    });
+
+    return bytes;
+}
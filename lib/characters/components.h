@@ -0,0 +1,158 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Entity;
+class Texture;
+
+// Components stores the state of the entities that changes every frame in dense arrays (one
+// array per field) so that the systems updating every entity at once only walk the data they
+// need instead of whole entities. An Entity is a facade over its slot in the arrays and keeps
+// the rest of its state (inventory, skills, paths, ...) to itself.
+//
+// The slots are kept packed: removing an entity moves the last one into its place, so the
+// arrays can be iterated from 0 to size() without gaps.
+class Components
+{
+public:
+    // Position and movement.
+    struct Motion
+    {
+        std::vector<float> position_x;
+        std::vector<float> position_y;
+        std::vector<float> position_z;
+        std::vector<float> velocity_x;
+        std::vector<float> velocity_y;
+        std::vector<float> velocity_z;
+        std::vector<float> acceleration_z;
+        std::vector<float> speed;
+        std::vector<float> max_speed;
+
+        // The time (in seconds) to move the entity by in the next integrate().
+        std::vector<float> elapsed;
+
+        // Whether the entity is in the air.
+        std::vector<uint8_t> jumping;
+
+        // Whether the entity sits out the next integrate() (set by its own update).
+        std::vector<uint8_t> paused;
+    };
+
+    // Sprite animation.
+    struct Animation
+    {
+        std::vector<uint8_t>  state;
+        std::vector<uint16_t> frame;
+        std::vector<uint16_t> rate;
+
+        // The ticks the animation was started at (only while playing).
+        std::vector<uint32_t> start;
+        std::vector<uint8_t>  playing;
+
+        // The number of frames played since the start whose events have been fired.
+        std::vector<uint32_t> fired;
+    };
+
+    // Combat statistics.
+    struct Stats
+    {
+        std::vector<int> health;
+        std::vector<int> max_health;
+        std::vector<int> mana;
+        std::vector<int> max_mana;
+        std::vector<int> stamina;
+        std::vector<int> max_stamina;
+        std::vector<int> attack_power;
+    };
+
+    // Rendering.
+    struct Render
+    {
+        std::vector<Texture*> texture;
+
+        // The last frame the entity was found visible.
+        std::vector<uint32_t> frame;
+    };
+
+    // Enemy behavior (see AI).
+    struct Behavior
+    {
+        std::vector<uint8_t> state;
+
+        // Where the entity was spawned (the center of the character).
+        std::vector<float> home_x;
+        std::vector<float> home_y;
+
+        // The ticks the current state was entered at and the player was last seen at.
+        std::vector<uint32_t> state_start;
+        std::vector<uint32_t> last_seen;
+    };
+
+    // Simulation level of detail (see Map::update()).
+    struct Detail
+    {
+        std::vector<uint8_t> tier;
+
+        // The ticks since the entity was last updated.
+        std::vector<uint32_t> pending;
+
+        // The ticks until which the entity is kept at full detail (after an event woke it up).
+        std::vector<uint32_t> awake_until;
+    };
+
+    // The level of detail tiers.
+    enum Tier : uint8_t
+    {
+        FULL_DETAIL    = 0,
+        REDUCED_DETAIL = 1,
+        DORMANT        = 2,
+    };
+
+public:
+    // Create an empty set of components.
+    explicit Components();
+
+    Components(const Components&)            = delete;
+    Components& operator=(const Components&) = delete;
+
+public:
+    // Add a slot for an entity and return its index. Every field starts at zero.
+    uint32_t add(Entity* owner);
+
+    // Remove a slot. The last slot is moved into its place and its owner is told its new index.
+    void remove(uint32_t index);
+
+    // Return the number of slots.
+    size_t size() const;
+
+    // Return the entity owning a slot.
+    Entity* owner(uint32_t index) const;
+
+    // The movement system: move every entity by its velocity over its elapsed time, keeping it on
+    // the map and landing the ones whose jump has come back down.
+    void integrate();
+
+    // Return the number of bytes allocated by the arrays.
+    size_t memory_usage() const;
+
+public:
+    Motion    motion;
+    Animation animation;
+    Stats     stats;
+    Render    render;
+    Behavior  behavior;
+    Detail    detail;
+
+private:
+    std::vector<Entity*> m_owners;
+
+    // The entities that landed during the last integrate().
+    std::vector<uint32_t> m_landed;
+};
@@ -7,28 +7,16 @@
 
 #include <SDL_render.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include "core/game.h"
 #include "core/logger.h"
 
 Entity::Entity(Type type, Game& game)
-  : m_position({ 0.0, 0.0, 0.0 })
-  , m_velocity({ 0.0, 0.0, 0.0 })
-  , m_acceleration({ 0.0, 0.0, 0.0 })
-  , m_health(1000)
-  , m_health_bars(BAR_COUNT)
-  , m_max_health(1000)
-  , m_mana(1000)
-  , m_mana_bars(BAR_COUNT)
-  , m_max_mana(1000)
-  , m_stamina(1000)
-  , m_stamina_bars(BAR_COUNT)
-  , m_max_stamina(1000)
-  , m_speed(12.0)
-  , m_max_speed(244)
-  , m_texture(nullptr)
+  : m_components(game.map.components())
+  , m_index(m_components.add(this))
   , m_states(states())
-  , m_current_state(State::WALK_DOWN)
-  , m_current_frame(0)
   , m_movement_direction(0)
   , m_sprite_direction(Direction::DOWN)
   , m_game(game)
@@ -36,196 +24,225 @@ Entity::Entity(Type type, Game& game)
   , m_col(0)
   , m_row(0)
   , m_type(type)
-  , m_attack_long_range(10)
-  , m_attack_short_range(3)
-  , m_attack_power(100)
-  , m_target(nullptr)
+  , m_handle()
+  , m_target()
   , m_destination({ 0, 0 })
   , m_walking_to_destination(false)
-  , m_jumping(false)
-  , m_animation_rate(16)
-  , m_sprite(SPRITE_PLAYER)
+  , m_final_destination({ 0, 0 })
+  , m_path_index(0)
+  , m_path_found(false)
+  , m_chase_cell({ -1, -1 })
+  , m_chase_destination({ 0, 0 })
+  , m_following_flow(false)
+  , m_archetype(nullptr)
+  , m_grid_cell(-1)
 {
-    m_skills.push_back(Skill(Skill::FIRE_MAGIC_251, 1));
-    m_skills.push_back(Skill(Skill::FIRE_MAGIC_252, 1));
-    m_skills.push_back(Skill(Skill::FIRE_MAGIC_253, 1));
-    m_skills.push_back(Skill(Skill::FIRE_MAGIC_254, 1));
-    m_skills.push_back(Skill(Skill::FIRE_MAGIC_255, 1));
-    m_skills.push_back(Skill(Skill::FIRE_MAGIC_256, 1));
-    m_skills.push_back(Skill(Skill::FIRE_MAGIC_257, 1));
-
-    m_skills.push_back(Skill(Skill::POTION_147, 1));
-    m_skills.push_back(Skill(Skill::POTION_150, 1));
-    m_skills.push_back(Skill(Skill::POTION_158, 1));
+    // The component slot starts zeroed (standing still at the origin, not animating or jumping)
+    // until the archetype fills in the rest.
+    current_state() = State::WALK_DOWN;
 }
 
-bool Entity::set_sprite(Sprite sprite)
+bool Entity::set_archetype(int id)
 {
-    if (m_sprite == sprite && m_texture != nullptr) {
+    if (m_archetype != nullptr && m_archetype->id == id) {
         return true;
     }
 
-    m_texture = m_game.get_entity_texture(sprite);
+    const auto archetype = m_game.archetypes.find(id);
+
+    if (archetype == nullptr) {
+        LOG_ERROR << "Unknown archetype: " << id << std::endl;
+        return false;
+    }
+
+    // The player's skills are used from the slots of the bar.
+    if (is_player() && archetype->skills.size() > SKILL_SLOT_COUNT) {
+        LOG_ERROR << "Too many skills for the player: " << archetype->name << " (" << archetype->skills.size()
+                  << ")" << std::endl;
+        return false;
+    }
+
+    texture() = m_game.get_entity_texture(*archetype);
 
-    if (m_texture == nullptr) {
+    if (texture() == nullptr) {
         return false;
     }
 
-    m_sprite = sprite;
+    m_archetype = archetype;
+
+    speed()          = archetype->speed;
+    max_speed()      = archetype->max_speed;
+    animation_rate() = jumping() ? archetype->jump_animation_rate : archetype->ground_animation_rate;
+
+    auto& stats = m_components.stats;
+
+    stats.health[m_index]       = archetype->health;
+    stats.max_health[m_index]   = archetype->health;
+    stats.mana[m_index]         = archetype->mana;
+    stats.max_mana[m_index]     = archetype->mana;
+    stats.stamina[m_index]      = archetype->stamina;
+    stats.max_stamina[m_index]  = archetype->stamina;
+    stats.attack_power[m_index] = archetype->attack_power;
+
+    // The counts and cooldowns are the entity's own.
+    m_skills = archetype->skills;
 
     return true;
 }
 
-Entity::Sprite Entity::sprite() const
+Handle Entity::handle() const
+{
+    return m_handle;
+}
+
+void Entity::set_handle(Handle handle)
+{
+    m_handle = handle;
+}
+
+uint32_t Entity::component_index() const
+{
+    return m_index;
+}
+
+void Entity::set_component_index(uint32_t index)
+{
+    m_index = index;
+}
+
+const Archetype& Entity::archetype() const
 {
-    return m_sprite;
+    return *m_archetype;
 }
 
 void Entity::update(uint32_t ticks)
 {
-    if (m_timer.started()) {
-        const auto ticks = m_timer.ticks();
+    // The movement system moves the entity after the update (unless it stops early).
+    paused()  = false;
+    elapsed() = ticks / 1000.0f;
+
+    if (animation_playing()) {
+        const auto ticks = SDL_GetTicks() - m_components.animation.start[m_index];
 
         // Dead now...
-        if (m_current_state == State::FALL && m_current_frame == 5) {
+        if (current_state() == State::FALL && current_frame() == 5) {
+            paused() = true;
             return stop_animation();
         }
 
-        // Update animation frame.
-        m_current_frame = (ticks * m_animation_rate) / 1000 % m_states[m_current_state].size();
+        // The frames played since the start (the first one as soon as it starts).
+        const auto played = static_cast<uint32_t>((ticks * animation_rate()) / 1000) + 1;
 
-        // Continue walking left/right.
-        if (m_velocity.x > 0.0) {
-            m_velocity.x += m_speed * (ticks / 1000.0f);
-        } else if (m_velocity.x < 0.0) {
-            m_velocity.x -= m_speed * (ticks / 1000.0f);
+        // Update animation frame (nobody sees it off screen, but the fall has to play out).
+        if (current_state() == State::FALL || m_game.map.on_screen(this)) {
+            current_frame() = (played - 1) % m_states[current_state()].size();
         }
 
-        // Continue walking up/down.
-        if (m_velocity.y > 0.0) {
-            m_velocity.y += m_speed * (ticks / 1000.0f);
-        } else if (m_velocity.y < 0.0) {
-            m_velocity.y -= m_speed * (ticks / 1000.0f);
-        }
+        // The events fire whether the animation is seen or not.
+        fire_animation_events(played);
 
-        if (ticks >= 1000) {
-            if (m_attacking) {
-                if (m_target->dead()) {
-                    stop_attacking();
-                } else {
-                    // Face towards target.
-                    face_towards_entity(m_target);
-
-                    // Damage the target.
-                    m_target->damage(rand() % m_attack_power);
-                }
-            }
+        // Continue walking left/right.
+        if (velocity_x() > 0.0) {
+            velocity_x() += speed() * (ticks / 1000.0f);
+        } else if (velocity_x() < 0.0) {
+            velocity_x() -= speed() * (ticks / 1000.0f);
+        }
 
-            // Restart the timer.
-            m_timer.start();
+        // Continue walking up/down.
+        if (velocity_y() > 0.0) {
+            velocity_y() += speed() * (ticks / 1000.0f);
+        } else if (velocity_y() < 0.0) {
+            velocity_y() -= speed() * (ticks / 1000.0f);
         }
     }
 
-    if (m_walking_to_destination) {
-        int px = m_position.x;
-        int py = m_position.y;
-        int dx = m_destination.x;
-        int dy = m_destination.y;
+    // Start on the path requested by chase() once it has been searched.
+    if (m_path_ticket != nullptr && m_path_ticket->done()) {
+        if (!m_path_ticket->cancelled()) {
+            m_final_destination = m_chase_destination;
 
-        // LOG_DEBUG << "Destination: "
-        //           << " " << dx << " " << dy << " " << px << " " << py << "\n";
+            m_path           = m_path_ticket->path();
+            m_path_found     = m_path_ticket->found();
+            m_following_flow = false;
 
-        if (dx < px) {
-            walk_in_direction(Direction::LEFT);
-        } else if (dx > px) {
-            walk_in_direction(Direction::RIGHT);
+            follow_path();
         }
 
-        if (dy < py) {
-            walk_in_direction(Direction::UP);
-        } else if (dy > py) {
-            walk_in_direction(Direction::DOWN);
-        }
+        m_path_ticket.reset();
+    }
+
+    if (m_walking_to_destination) {
+        const auto dt   = ticks / 1000.0f;
+        const auto last = m_path_index + 1 >= m_path.size();
+
+        // Take the next step down the flow field (the path only ever holds the tile being walked to).
+        const auto next = m_following_flow && last ? m_game.map.flow_field().next(m_path.back())
+                                                    : SearchGraph::Cell{ -1, -1 };
+
+        // Only the end of the path has to be reached, every other waypoint is walked past.
+        const auto passing = !last || (m_following_flow && !(next == m_path.back()));
+
+        auto dx       = m_destination.x - position_x();
+        auto dy       = m_destination.y - position_y();
+        auto distance = std::hypot(dx, dy);
+
+        if (passing && distance <= std::max(max_speed() * dt, static_cast<float>(WAYPOINT_TOLERANCE))) {
+            // Head for the next waypoint once this frame's step would reach this one.
+            if (last) {
+                m_path.back() = next;
+            } else {
+                ++m_path_index;
+            }
 
-        m_velocity.x = (dx - px) * m_speed;
-        m_velocity.y = (dy - py) * m_speed;
+            m_destination = waypoint(m_path_index);
 
-        if (px == dx && py == dy) {
+            dx       = m_destination.x - position_x();
+            dy       = m_destination.y - position_y();
+            distance = std::hypot(dx, dy);
+        } else if (!passing && distance <= ARRIVAL_TOLERANCE) {
             // We have reached our destination now.
+            position_x() = m_destination.x;
+            position_y() = m_destination.y;
+
             m_walking_to_destination = false;
+            m_following_flow         = false;
+            m_path.clear();
 
             // Stop walking animation.
             stop_walking();
 
             m_sprite_direction = Direction::UP;
 
-            m_velocity.x = 0;
-            m_velocity.y = 0;
+            velocity_x() = 0;
+            velocity_y() = 0;
+
+            paused() = true;
 
             return;
         }
-    }
-
-    // Entity has stopped moving.
-    if (m_velocity.x == 0.0 && m_velocity.y == 0.0 && m_velocity.z == 0.0) {
-        return;
-    }
-
-    const auto dt = (ticks / 1000.0f);
-
-    if (m_velocity.x > m_max_speed) {
-        m_velocity.x = m_max_speed;
-    } else if (m_velocity.x < -m_max_speed) {
-        m_velocity.x = -m_max_speed;
-    }
-
-    // Do not exceed maximum Y speed.
-    if (m_velocity.y > m_max_speed) {
-        m_velocity.y = m_max_speed;
-    } else if (m_velocity.y < -m_max_speed) {
-        m_velocity.y = -m_max_speed;
-    }
-
-    // LOG_DEBUG << dt << "\n";
-
-    LOG_DEBUG << "Velocity Y: " << m_velocity.y << " Velocity X: " << m_velocity.x << " Velocity Z: " << m_velocity.z
-              << " DT: " << dt << "\n";
 
-    m_position.x += m_velocity.x * dt;
-
-    if (m_position.x < 0) {
-        m_position.x = 0;
-    } else if (m_position.x + CHARACTER_WIDTH > MAP_WIDTH) {
-        m_position.x = MAP_WIDTH - CHARACTER_WIDTH;
-    }
-
-    m_position.y += m_velocity.y * dt;
-
-    if (m_position.y < 0) {
-        m_position.y = 0;
-    } else if (m_position.y + CHARACTER_HEIGHT > MAP_HEIGHT) {
-        m_position.y = MAP_HEIGHT - CHARACTER_HEIGHT;
-    }
+        if (dx <= -1.0f) {
+            walk_in_direction(Direction::LEFT);
+        } else if (dx >= 1.0f) {
+            walk_in_direction(Direction::RIGHT);
+        }
 
-    if (m_jumping) {
-        // LOG_DEBUG << "JUMP: " << m_position.z << "\n";
+        if (dy <= -1.0f) {
+            walk_in_direction(Direction::UP);
+        } else if (dy >= 1.0f) {
+            walk_in_direction(Direction::DOWN);
+        }
 
-        m_position.z += (m_velocity.z * dt);
+        // Steer straight at the waypoint, slowing down at the end of the path so that the last step
+        // lands on it instead of overshooting.
+        auto walk_speed = max_speed();
 
-        if (m_position.z < 0) {
-            m_position.z = 0;
-        } else if (m_position.z + CHARACTER_HEIGHT > MAP_HEIGHT) {
-            m_position.z = MAP_HEIGHT - CHARACTER_HEIGHT;
+        if (!passing && dt > 0.0f) {
+            walk_speed = std::min(walk_speed, distance / dt);
         }
 
-        // On the ground again.
-        if (m_position.z >= m_position.y) {
-            finish_jump();
-        } else {
-            m_velocity.z += m_acceleration.z * dt;
-        }
-    } else {
-        m_position.z = m_position.y;
+        velocity_x() = distance > 0.0f ? dx / distance * walk_speed : 0.0f;
+        velocity_y() = distance > 0.0f ? dy / distance * walk_speed : 0.0f;
     }
 }
 
@@ -246,66 +263,68 @@ bool Entity::attacking() const
 
 void Entity::start_animation()
 {
-    if (!m_timer.started()) {
-        m_timer.start();
+    if (!animation_playing()) {
+        animation_playing()                   = true;
+        animation_fired()                     = 0;
+        m_components.animation.start[m_index] = SDL_GetTicks();
     }
 }
 
 void Entity::stop_animation()
 {
-    m_timer.stop();
+    animation_playing() = false;
 }
 
 bool Entity::is_near_entity(Entity* entity)
 {
-    return entity->column() > m_col - m_attack_short_range && entity->column() < m_col + m_attack_short_range
-           && entity->row() > m_row - m_attack_short_range && entity->row() < m_row + m_attack_short_range;
+    const auto range = m_archetype->attack_short_range;
+
+    return entity->column() > m_col - range && entity->column() < m_col + range && entity->row() > m_row - range
+           && entity->row() < m_row + range;
 }
 
 void Entity::damage(int amount)
 {
-    if (m_health <= 0) {
+    if (health() <= 0) {
         return;
     }
 
     LOG_DEBUG << "Entity received damaged:  " << amount << "\n";
 
-    set_health(m_health - amount);
+    set_health(health() - amount);
 
-    if (m_health <= 0) {
+    if (health() <= 0) {
         fall();
     }
-
-    auto texture = m_damage_stack.insert(m_damage_stack.end(), std::make_unique<Texture>())->get();
-
-    if (!texture->load_from_text(m_game.window.renderer(), std::to_string(amount).c_str(), m_game.font(),
-                                 { 255, 255, 255, 255 })) {
-        LOG_ERROR << "Failed to load damage texture text" << std::endl;
-        return;
-    }
-
-    texture->set_scale(std::max(1.0, std::min(2.0, (static_cast<float>(amount) / static_cast<float>(100)) * 2.0)));
-    texture->set_rotation(rand() % 20);
 }
 
 void Entity::face_towards_entity(Entity* entity)
 {
-    LOG_DEBUG << entity->pos_y() << " " << m_position.y << "\n";
+    LOG_DEBUG << entity->pos_y() << " " << position_y() << "\n";
 
-    if (entity->pos_y() > m_position.y) {
+    if (entity->pos_y() > position_y()) {
         m_sprite_direction = Direction::DOWN;
-    } else if (entity->pos_y() < m_position.y) {
+    } else if (entity->pos_y() < position_y()) {
         m_sprite_direction = Direction::UP;
-    } else if (entity->pos_x() > m_position.x) {
+    } else if (entity->pos_x() > position_x()) {
         m_sprite_direction = Direction::RIGHT;
-    } else if (entity->pos_x() < m_position.x) {
+    } else if (entity->pos_x() < position_x()) {
         m_sprite_direction = Direction::LEFT;
     }
 }
 
 bool Entity::dead() const
 {
-    return m_health <= 0;
+    return health() <= 0;
+}
+
+Entity* Entity::find_target(int tile_range)
+{
+    const auto radius = static_cast<float>(tile_range * MAP_TILE_SIZE);
+
+    return m_game.map.spatial_grid().nearest(center_x(), center_y(), radius, [this](Entity* entity) {
+        return entity != this && !entity->dead();
+    });
 }
 
 void Entity::auto_attack()
@@ -314,35 +333,8 @@ void Entity::auto_attack()
         return;
     }
 
-    SDL_Rect range;
-    range.x = (m_col - m_attack_long_range) * MAP_TILE_SIZE;
-    range.y = (m_row - m_attack_long_range) * MAP_TILE_SIZE;
-    range.w = (m_col + m_attack_long_range) * MAP_TILE_SIZE;
-    range.h = (m_row + m_attack_long_range) * MAP_TILE_SIZE;
-
-    SDL_Rect result;
-
-    auto entities = std::vector<Entity*>(m_game.map.entities());
-
-    // Sort the entities by distance from us.
-    std::sort(entities.begin(), entities.end(), [this](Entity* a, Entity* b) {
-        return (std::sqrt(std::pow(a->pos_x() - this->pos_x(), 2) + std::pow(a->pos_y() - this->pos_y(), 2)))
-               < (std::sqrt(std::pow(b->pos_x() - this->pos_x(), 2) + std::pow(b->pos_y() - this->pos_y(), 2)));
-    });
-
-    for (auto& entity : entities) {
-        if (entity != this && !entity->dead()) {
-            SDL_Rect box;
-
-            box.x = entity->pos_x() - CHARACTER_WIDTH;
-            box.y = entity->pos_y() - CHARACTER_HEIGHT;
-            box.w = CHARACTER_WIDTH;
-            box.h = CHARACTER_HEIGHT;
-
-            if (SDL_IntersectRect(&range, &box, &result)) {
-                return attack(entity);
-            }
-        }
+    if (auto entity = find_target(m_archetype->attack_long_range); entity != nullptr) {
+        return attack(entity);
     }
 
     m_game.dialogue.play_notice(Dialogue::Notice::NO_ENEMIES_NEARBY);
@@ -359,30 +351,46 @@ void Entity::attack(Entity* entity)
     }
 
     // Update the target.
-    m_target = entity;
+    m_target = entity->handle();
+
+    // Stand still while attacking.
+    stop_walking_to_position();
 
     // walk_to_position(entity->pos_x() + CHARACTER_HORIZONTAL_CENTER, entity->pos_y());
 
     m_game.audio.play_sound(Audio::Sound::KNIFE_SLICE2, 0);
-    m_game.audio.play_sound(Audio::Sound::KNIFE_SLICE2, -1);
 
     m_attacking = true;
 
-    m_velocity.x = 0;
-    m_velocity.y = 0;
+    velocity_x() = 0;
+    velocity_y() = 0;
 
-    // Start attacking animation.
+    // Start attacking animation (from its first frame, whatever was playing).
+    stop_animation();
     start_animation();
 
     set_action(Action::WIDE_SLASH);
 }
 
+void Entity::strike()
+{
+    if (auto target = m_game.map.entity(m_target); target == nullptr || target->dead()) {
+        stop_attacking();
+    } else {
+        // Face towards target.
+        face_towards_entity(target);
+
+        // Hit the target (the damage is dealt once every entity has been updated).
+        m_game.combat.melee(m_handle, m_target, rand() % m_components.stats.attack_power[m_index]);
+    }
+}
+
 void Entity::stop_attacking()
 {
     m_attacking     = false;
-    m_current_frame = 0;
-    m_velocity.x    = 0;
-    m_velocity.y    = 0;
+    current_frame() = 0;
+    velocity_x()    = 0;
+    velocity_y()    = 0;
 
     // Stop attacking animation.
     stop_animation();
@@ -415,11 +423,11 @@ void Entity::stop_moving_horizontally()
     if (m_attacking) {
         stop_attacking();
     } else {
-        m_velocity.x    = 0;
-        m_current_frame = 0;
+        velocity_x()    = 0;
+        current_frame() = 0;
     }
 
-    if (m_velocity.y == 0.0) {
+    if (velocity_y() == 0.0) {
         stop_animation();
     }
 
@@ -430,10 +438,10 @@ void Entity::stop_moving_horizontally()
     }
 
     if (is_moving(Direction::UP)) {
-        m_current_state    = State::WALK_UP;
+        current_state()    = State::WALK_UP;
         m_sprite_direction = Direction::UP;
     } else if (is_moving(Direction::DOWN)) {
-        m_current_state    = State::WALK_DOWN;
+        current_state()    = State::WALK_DOWN;
         m_sprite_direction = Direction::DOWN;
     }
 }
@@ -445,12 +453,12 @@ void Entity::stop_moving_vertically()
     if (m_attacking) {
         stop_attacking();
     } else {
-        m_velocity.z    = 0;
-        m_velocity.y    = 0;
-        m_current_frame = 0;
+        velocity_z()    = 0;
+        velocity_y()    = 0;
+        current_frame() = 0;
     }
 
-    if (m_velocity.x == 0.0) {
+    if (velocity_x() == 0.0) {
         stop_animation();
     }
 
@@ -461,10 +469,10 @@ void Entity::stop_moving_vertically()
     }
 
     if (is_moving(Direction::RIGHT)) {
-        m_current_state    = State::WALK_RIGHT;
+        current_state()    = State::WALK_RIGHT;
         m_sprite_direction = Direction::RIGHT;
     } else if (is_moving(Direction::LEFT)) {
-        m_current_state    = State::WALK_LEFT;
+        current_state()    = State::WALK_LEFT;
         m_sprite_direction = Direction::LEFT;
     }
 }
@@ -477,8 +485,8 @@ void Entity::walk_in_direction(Direction direction)
             stop_moving_horizontally();
         }
 
-        if (m_current_state != State::WALK_LEFT) {
-            m_current_state    = State::WALK_LEFT;
+        if (current_state() != State::WALK_LEFT) {
+            current_state()    = State::WALK_LEFT;
             m_sprite_direction = Direction::LEFT;
         }
 
@@ -489,7 +497,7 @@ void Entity::walk_in_direction(Direction direction)
         LOG_DEBUG << "Started walking left\n";
 
         m_movement_direction |= Direction::LEFT;
-        m_velocity.x = -m_speed;
+        velocity_x() = -speed();
 
         break;
     case RIGHT:
@@ -497,8 +505,8 @@ void Entity::walk_in_direction(Direction direction)
             stop_moving_horizontally();
         }
 
-        if (m_current_state != State::WALK_RIGHT) {
-            m_current_state    = State::WALK_RIGHT;
+        if (current_state() != State::WALK_RIGHT) {
+            current_state()    = State::WALK_RIGHT;
             m_sprite_direction = Direction::RIGHT;
         }
 
@@ -509,12 +517,12 @@ void Entity::walk_in_direction(Direction direction)
         LOG_DEBUG << "Started walking right\n";
 
         m_movement_direction |= Direction::RIGHT;
-        m_velocity.x = m_speed;
+        velocity_x() = speed();
 
         break;
     case UP:
-        if (m_current_state != State::WALK_UP && !is_moving(Direction::LEFT) && !is_moving(Direction::RIGHT)) {
-            m_current_state    = State::WALK_UP;
+        if (current_state() != State::WALK_UP && !is_moving(Direction::LEFT) && !is_moving(Direction::RIGHT)) {
+            current_state()    = State::WALK_UP;
             m_sprite_direction = Direction::UP;
         }
 
@@ -524,13 +532,13 @@ void Entity::walk_in_direction(Direction direction)
 
         LOG_DEBUG << "Started walking up\n";
 
-        m_velocity.y = -m_speed;
+        velocity_y() = -speed();
         m_movement_direction |= Direction::UP;
 
         break;
     case DOWN:
-        if (m_current_state != State::WALK_DOWN && !is_moving(Direction::LEFT) && !is_moving(Direction::RIGHT)) {
-            m_current_state    = State::WALK_DOWN;
+        if (current_state() != State::WALK_DOWN && !is_moving(Direction::LEFT) && !is_moving(Direction::RIGHT)) {
+            current_state()    = State::WALK_DOWN;
             m_sprite_direction = Direction::DOWN;
         }
 
@@ -540,38 +548,78 @@ void Entity::walk_in_direction(Direction direction)
 
         LOG_DEBUG << "Started walking down\n";
 
-        m_velocity.y = m_speed;
+        velocity_y() = speed();
         m_movement_direction |= Direction::DOWN;
 
         break;
     }
 
-    // Play footstep sounds.
-    m_game.audio.play_sound(Audio::Sound::FOOTSTEP02, 0);
-
     // Start character walking animation.
     start_animation();
 }
 
 void Entity::fall()
 {
-    if (m_current_state == State::FALL) {
+    if (current_state() == State::FALL) {
         return;
     }
 
-    m_current_state = State::FALL;
+    current_state() = State::FALL;
 
     start_animation();
 }
 
 float Entity::pos_x() const
 {
-    return m_position.x;
+    return position_x();
 }
 
 float Entity::pos_y() const
 {
-    return m_position.y;
+    return position_y();
+}
+
+float Entity::pos_z() const
+{
+    return position_z();
+}
+
+float Entity::center_x() const
+{
+    return position_x() + CHARACTER_HORIZONTAL_CENTER;
+}
+
+float Entity::center_y() const
+{
+    return position_y() + CHARACTER_VERTICAL_CENTER;
+}
+
+int Entity::grid_cell() const
+{
+    return m_grid_cell;
+}
+
+void Entity::set_grid_cell(int cell)
+{
+    m_grid_cell = cell;
+}
+
+SDL_Rect Entity::render_bounds() const
+{
+    // The wide sprites extend one character in every direction which also covers the
+    // damage text floating above the character.
+    return { static_cast<int>(position_x()) - CHARACTER_WIDTH, static_cast<int>(position_z()) - CHARACTER_HEIGHT,
+             CHARACTER_WIDE_WIDTH, CHARACTER_WIDE_HEIGHT };
+}
+
+uint32_t Entity::render_frame() const
+{
+    return m_components.render.frame[m_index];
+}
+
+void Entity::set_render_frame(uint32_t frame)
+{
+    m_components.render.frame[m_index] = frame;
 }
 
 bool Entity::is_player() const
@@ -581,125 +629,219 @@ bool Entity::is_player() const
 
 void Entity::set_health(int health)
 {
-    m_health      = health;
-    m_health_bars = (static_cast<float>(m_health) / static_cast<float>(m_max_health)) * BAR_COUNT;
+    m_components.stats.health[m_index] = health;
 }
 
 void Entity::set_mana(int mana)
 {
-    m_mana      = mana;
-    m_mana_bars = (static_cast<float>(m_mana) / static_cast<float>(m_max_mana)) * BAR_COUNT;
+    m_components.stats.mana[m_index] = mana;
 }
 
 void Entity::set_stamina(int stamina)
 {
-    m_stamina      = stamina;
-    m_stamina_bars = (static_cast<float>(m_stamina) / static_cast<float>(m_max_stamina)) * BAR_COUNT;
+    m_components.stats.stamina[m_index] = stamina;
 }
 
 void Entity::set_position(int x, int y)
 {
-    m_position.x = x - (CHARACTER_WIDTH / 2);
-    m_position.y = y - (CHARACTER_HEIGHT / 2);
-    m_position.z = m_position.y;
+    position_x() = x - (CHARACTER_WIDTH / 2);
+    position_y() = y - (CHARACTER_HEIGHT / 2);
+    position_z() = position_y();
 }
 
 void Entity::walk_to_position(int x, int y)
 {
-    m_destination.x = x - (CHARACTER_WIDTH / 2);
-    m_destination.y = y - (CHARACTER_HEIGHT / 2);
+    m_final_destination.x = x - (CHARACTER_WIDTH / 2);
+    m_final_destination.y = y - (CHARACTER_HEIGHT / 2);
+
+    m_following_flow = false;
+
+    cancel_path_request();
+
+    // Route around the walls (the path ends next to the destination if it cannot be reached).
+    m_path_found = m_game.map.search_graph().find_path(
+      cell(), cell_at(m_final_destination.x, m_final_destination.y), m_path, SearchGraph::JUMP_POINT);
+
+    follow_path();
+}
+
+void Entity::stop_walking_to_position()
+{
+    m_walking_to_destination = false;
+    m_following_flow         = false;
+    m_path.clear();
+
+    cancel_path_request();
+}
+
+bool Entity::walking() const
+{
+    return m_walking_to_destination || m_path_ticket != nullptr;
+}
+
+void Entity::follow_path()
+{
+    if (m_path.empty()) {
+        // Either we are already standing on the destination tile or there is nowhere to go.
+        if (!m_path_found) {
+            return;
+        }
+
+        m_path.push_back(cell_at(m_final_destination.x, m_final_destination.y));
+    }
+
+    // Walk straight past the waypoints that can be seen from the previous one.
+    m_game.map.search_graph().smooth_path(cell(), m_path);
+
+    m_path_index  = 0;
+    m_destination = waypoint(m_path_index);
 
     m_walking_to_destination = true;
 }
 
+void Entity::cancel_path_request()
+{
+    if (m_path_ticket != nullptr) {
+        m_game.map.pathfinder().cancel(m_handle);
+        m_path_ticket.reset();
+    }
+}
+
+void Entity::chase(Entity* entity)
+{
+    const auto target = entity->cell();
+
+    // Follow the flow field if it leads to the target (the last step onto the target's tile is
+    // walked like any other path).
+    if (const auto& flow = m_game.map.flow_field(); flow.root() == target && !(cell() == target)
+                                                    && flow.distance(cell()) != FlowField::UNREACHABLE) {
+        if (!m_following_flow) {
+            cancel_path_request();
+
+            m_following_flow = true;
+
+            m_path.assign(1, flow.next(cell()));
+            m_path_index  = 0;
+            m_path_found  = false;
+            m_destination = waypoint(m_path_index);
+
+            m_walking_to_destination = true;
+        }
+
+        return;
+    }
+
+    // Only search again once the target has moved to another tile.
+    if ((m_walking_to_destination || m_path_ticket != nullptr) && !m_following_flow && target == m_chase_cell) {
+        return;
+    }
+
+    m_chase_cell        = target;
+    m_chase_destination = { static_cast<int>(entity->center_x()) - (CHARACTER_WIDTH / 2),
+                            static_cast<int>(entity->center_y()) - (CHARACTER_HEIGHT / 2) };
+
+    // Asking again replaces the request for the target's previous tile.
+    m_path_ticket = m_game.map.pathfinder().request(m_handle, cell(), target, SearchGraph::JUMP_POINT);
+}
+
+SearchGraph::Cell Entity::cell() const
+{
+    return cell_at(position_x(), position_y());
+}
+
+SearchGraph::Cell Entity::cell_at(float x, float y)
+{
+    // The tile under the center of the bounding box.
+    return { static_cast<int>(y + BOUNDING_BOX_VERTICAL_CENTER) / MAP_TILE_SIZE,
+             static_cast<int>(x + CHARACTER_HORIZONTAL_CENTER) / MAP_TILE_SIZE };
+}
+
+Vector2D<int> Entity::waypoint(size_t index) const
+{
+    // The exact destination can only be used if the path actually gets there (never into a wall).
+    if (index + 1 == m_path.size() && m_path_found
+        && m_path[index] == cell_at(m_final_destination.x, m_final_destination.y)
+        && !m_game.map.search_graph().agent_collision().blocked(m_path[index].row, m_path[index].column)) {
+        return m_final_destination;
+    }
+
+    // Center the bounding box on the tile.
+    return { m_path[index].column * MAP_TILE_SIZE + MAP_TILE_SIZE / 2 - CHARACTER_HORIZONTAL_CENTER,
+             m_path[index].row * MAP_TILE_SIZE + MAP_TILE_SIZE / 2 - BOUNDING_BOX_VERTICAL_CENTER };
+}
+
 void Entity::jump()
 {
-    if (m_jumping || m_velocity.y != 0.0) {
+    if (jumping() || velocity_y() != 0.0) {
         return;
     }
 
-    m_velocity.z -= sqrt(2.0f * GRAVITY * JUMP_HEIGHT);
-    m_acceleration.z = -m_velocity.z;
+    velocity_z() -= sqrt(2.0f * GRAVITY * JUMP_HEIGHT);
+    acceleration_z() = -velocity_z();
 
-    m_jumping        = true;
-    m_animation_rate = 60;
+    jumping()        = true;
+    animation_rate() = m_archetype->jump_animation_rate;
 
     start_animation();
 
     if ((m_movement_direction & Direction::RIGHT) == Direction::RIGHT) {
-        m_current_state    = State::WALK_RIGHT;
+        current_state()    = State::WALK_RIGHT;
         m_sprite_direction = Direction::RIGHT;
     } else if ((m_movement_direction & Direction::LEFT) == Direction::LEFT) {
-        m_current_state    = State::WALK_LEFT;
+        current_state()    = State::WALK_LEFT;
         m_sprite_direction = Direction::LEFT;
     } else if ((m_movement_direction & Direction::UP) == Direction::UP) {
-        m_current_state    = State::WALK_UP;
+        current_state()    = State::WALK_UP;
         m_sprite_direction = Direction::UP;
     } else if ((m_movement_direction & Direction::DOWN) == Direction::DOWN) {
-        m_current_state    = State::WALK_DOWN;
+        current_state()    = State::WALK_DOWN;
         m_sprite_direction = Direction::DOWN;
     }
 }
 
-void Entity::finish_jump()
-{
-    m_jumping = false;
-
-    m_position.z = m_position.y;
-    m_velocity.z = 0;
-
-    m_current_frame = 0;
-
-    if (m_velocity.x == 0.0 && m_velocity.y == 0.0) {
-        stop_animation();
-    }
-
-    m_animation_rate = 16;
-}
-
 int Entity::health() const
 {
-    return m_health;
+    return m_components.stats.health[m_index];
 }
 
 int Entity::health_bars() const
 {
-    return m_health_bars;
+    return (static_cast<float>(health()) / static_cast<float>(max_health())) * BAR_COUNT;
 }
 
 int Entity::max_health() const
 {
-    return m_max_health;
+    return m_components.stats.max_health[m_index];
 }
 
 int Entity::mana() const
 {
-    return m_mana;
+    return m_components.stats.mana[m_index];
 }
 
 int Entity::mana_bars() const
 {
-    return m_mana_bars;
+    return (static_cast<float>(mana()) / static_cast<float>(max_mana())) * BAR_COUNT;
 }
 
 int Entity::max_mana() const
 {
-    return m_max_mana;
+    return m_components.stats.max_mana[m_index];
 }
 
 int Entity::stamina() const
 {
-    return m_stamina;
+    return m_components.stats.stamina[m_index];
 }
 
 int Entity::stamina_bars() const
 {
-    return m_stamina_bars;
+    return (static_cast<float>(stamina()) / static_cast<float>(max_stamina())) * BAR_COUNT;
 }
 
 int Entity::max_stamina() const
 {
-    return m_max_stamina;
+    return m_components.stats.max_stamina[m_index];
 }
 
 const std::vector<Skill>& Entity::skills() const
@@ -711,20 +853,20 @@ void Entity::check_collision()
 {
     switch (m_sprite_direction) {
     case Direction::LEFT:
-        m_col = (m_position.x + CHARACTER_BOUNDING_BOX_LEFT) / MAP_TILE_SIZE;
-        m_row = (m_position.y + CHARACTER_BOUNDING_BOX_BOTTOM) / MAP_TILE_SIZE;
+        m_col = (position_x() + CHARACTER_BOUNDING_BOX_LEFT) / MAP_TILE_SIZE;
+        m_row = (position_y() + CHARACTER_BOUNDING_BOX_BOTTOM) / MAP_TILE_SIZE;
         break;
     case Direction::RIGHT:
-        m_col = (m_position.x + CHARACTER_BOUNDING_BOX_RIGHT) / MAP_TILE_SIZE;
-        m_row = (m_position.y + CHARACTER_BOUNDING_BOX_BOTTOM) / MAP_TILE_SIZE;
+        m_col = (position_x() + CHARACTER_BOUNDING_BOX_RIGHT) / MAP_TILE_SIZE;
+        m_row = (position_y() + CHARACTER_BOUNDING_BOX_BOTTOM) / MAP_TILE_SIZE;
         break;
     case Direction::UP:
-        m_col = (m_position.x + CHARACTER_BOUNDING_BOX_LEFT) / MAP_TILE_SIZE;
-        m_row = (m_position.y + CHARACTER_BOUNDING_BOX_BOTTOM) / MAP_TILE_SIZE;
+        m_col = (position_x() + CHARACTER_BOUNDING_BOX_LEFT) / MAP_TILE_SIZE;
+        m_row = (position_y() + CHARACTER_BOUNDING_BOX_BOTTOM) / MAP_TILE_SIZE;
         break;
     case Direction::DOWN:
-        m_col = (m_position.x + CHARACTER_BOUNDING_BOX_RIGHT) / MAP_TILE_SIZE;
-        m_row = (m_position.y + CHARACTER_BOUNDING_BOX_BOTTOM) / MAP_TILE_SIZE;
+        m_col = (position_x() + CHARACTER_BOUNDING_BOX_RIGHT) / MAP_TILE_SIZE;
+        m_row = (position_y() + CHARACTER_BOUNDING_BOX_BOTTOM) / MAP_TILE_SIZE;
         break;
     }
 
@@ -740,7 +882,7 @@ void Entity::check_collision()
             case Tile::BIG_GOLD_BAR_2:
             case Tile::BIG_GOLD_BAR_3:
                 m_inventory.add_gold(1);
-                tile.set_fg(-1);
+                m_game.map.clear_fg(m_row, m_col);
                 m_game.dialogue.play_exchange(Dialogue::TUTORIAL_0);
                 return;
             case Tile::DOOR_1:
@@ -756,100 +898,141 @@ void Entity::check_collision()
 
         switch (m_sprite_direction) {
         case Direction::LEFT:
-            m_position.x = ((m_col + 1) * MAP_TILE_SIZE) - (CHARACTER_BOUNDING_BOX_LEFT + 1);
+            position_x() = ((m_col + 1) * MAP_TILE_SIZE) - (CHARACTER_BOUNDING_BOX_LEFT + 1);
             break;
         case Direction::RIGHT:
-            m_position.x = (m_col * MAP_TILE_SIZE) - (CHARACTER_BOUNDING_BOX_RIGHT + 1);
+            position_x() = (m_col * MAP_TILE_SIZE) - (CHARACTER_BOUNDING_BOX_RIGHT + 1);
             break;
         case Direction::UP:
-            m_position.y = ((m_row + 1) * MAP_TILE_SIZE) - (CHARACTER_BOUNDING_BOX_TOP + 1);
+            position_y() = ((m_row + 1) * MAP_TILE_SIZE) - (CHARACTER_BOUNDING_BOX_TOP + 1);
             break;
         case Direction::DOWN:
-            m_position.y = (m_row * MAP_TILE_SIZE) - CHARACTER_BOUNDING_BOX_BOTTOM;
+            position_y() = (m_row * MAP_TILE_SIZE) - CHARACTER_BOUNDING_BOX_BOTTOM;
             break;
         }
     }
 }
 
+void Entity::fire_animation_events(uint32_t played)
+{
+    auto& fired = animation_fired();
+
+    // Slower after landing, the count starts over.
+    if (played < fired) {
+        fired = played;
+    }
+
+    const auto& track = m_archetype->tracks[animation_of(current_state())];
+    const auto  count = static_cast<uint32_t>(m_states[current_state()].size());
+
+    if (track.empty()) {
+        fired = played;
+        return;
+    }
+
+    // Every frame fires at most once per update (a long update does not replay whole loops).
+    for (auto i = std::max(fired, played > count ? played - count : 0); i < played; ++i) {
+        const auto frame = i % count;
+
+        for (const auto& event : track) {
+            if (event.frame == frame) {
+                m_game.map.animation_events().push(m_handle, event.type);
+            }
+        }
+    }
+
+    fired = played;
+}
+
+AnimationEvent::Animation Entity::animation_of(uint8_t state)
+{
+    // Every animation but the fall comes in four directions.
+    if (state < FALL) {
+        return static_cast<AnimationEvent::Animation>(state / 4);
+    }
+
+    return state == FALL ? AnimationEvent::FALL : AnimationEvent::WIDE_SLASH;
+}
+
 void Entity::set_action(Action action)
 {
     switch (action) {
     case Action::OPEN_ARMS:
         switch (m_sprite_direction) {
         case Direction::LEFT:
-            m_current_state = State::OPEN_ARMS_LEFT;
+            current_state() = State::OPEN_ARMS_LEFT;
             return;
         case Direction::RIGHT:
-            m_current_state = State::OPEN_ARMS_RIGHT;
+            current_state() = State::OPEN_ARMS_RIGHT;
             return;
         case Direction::UP:
-            m_current_state = State::OPEN_ARMS_UP;
+            current_state() = State::OPEN_ARMS_UP;
             return;
         case Direction::DOWN:
-            m_current_state = State::OPEN_ARMS_DOWN;
+            current_state() = State::OPEN_ARMS_DOWN;
             return;
         }
     case Action::SPEAR_ATTACK:
         switch (m_sprite_direction) {
         case Direction::LEFT:
-            m_current_state = State::SPEAR_ATTACK_LEFT;
+            current_state() = State::SPEAR_ATTACK_LEFT;
             return;
         case Direction::RIGHT:
-            m_current_state = State::SPEAR_ATTACK_RIGHT;
+            current_state() = State::SPEAR_ATTACK_RIGHT;
             return;
         case Direction::UP:
-            m_current_state = State::SPEAR_ATTACK_UP;
+            current_state() = State::SPEAR_ATTACK_UP;
             return;
         case Direction::DOWN:
-            m_current_state = State::SPEAR_ATTACK_DOWN;
+            current_state() = State::SPEAR_ATTACK_DOWN;
             return;
         }
     case Action::WALK:
         switch (m_sprite_direction) {
         case Direction::LEFT:
-            m_current_state = State::WALK_LEFT;
+            current_state() = State::WALK_LEFT;
             return;
         case Direction::RIGHT:
-            m_current_state = State::WALK_RIGHT;
+            current_state() = State::WALK_RIGHT;
             return;
         case Direction::UP:
-            m_current_state = State::WALK_UP;
+            current_state() = State::WALK_UP;
             return;
         case Direction::DOWN:
-            m_current_state = State::WALK_DOWN;
+            current_state() = State::WALK_DOWN;
             return;
         }
     case Action::SLASH:
         switch (m_sprite_direction) {
         case Direction::LEFT:
-            m_current_state = State::SLASH_ATTACK_LEFT;
+            current_state() = State::SLASH_ATTACK_LEFT;
             return;
         case Direction::RIGHT:
-            m_current_state = State::SLASH_ATTACK_RIGHT;
+            current_state() = State::SLASH_ATTACK_RIGHT;
             return;
         case Direction::UP:
-            m_current_state = State::SLASH_ATTACK_UP;
+            current_state() = State::SLASH_ATTACK_UP;
             return;
         case Direction::DOWN:
-            m_current_state = State::SLASH_ATTACK_DOWN;
+            current_state() = State::SLASH_ATTACK_DOWN;
             return;
         }
     case Action::FALL:
-        m_current_state = State::FALL;
+        current_state() = State::FALL;
         return;
     case Action::WIDE_SLASH:
         switch (m_sprite_direction) {
         case Direction::LEFT:
-            m_current_state = State::WIDE_SLASH_LEFT;
+            current_state() = State::WIDE_SLASH_LEFT;
             return;
         case Direction::RIGHT:
-            m_current_state = State::WIDE_SLASH_RIGHT;
+            current_state() = State::WIDE_SLASH_RIGHT;
             return;
         case Direction::UP:
-            m_current_state = State::WIDE_SLASH_UP;
+            current_state() = State::WIDE_SLASH_UP;
             return;
         case Direction::DOWN:
-            m_current_state = State::WIDE_SLASH_DOWN;
+            current_state() = State::WIDE_SLASH_DOWN;
             return;
         }
     }
@@ -857,9 +1040,14 @@ void Entity::set_action(Action action)
 
 void Entity::use_skill(int skill_number)
 {
+    // The slot may be empty (the skills come from the archetype).
+    if (skill_number < 0 || skill_number >= static_cast<int>(m_skills.size())) {
+        return;
+    }
+
     auto& skill = m_skills[skill_number];
 
-    if (skill.mana_required() > m_mana) {
+    if (skill.mana_required() > mana()) {
         m_game.dialogue.play_notice(Dialogue::Notice::NOT_ENOUGH_MANA);
         return;
     }
@@ -878,17 +1066,27 @@ void Entity::use_skill(int skill_number)
 
         m_game.dialogue.play_notice(Dialogue::Notice::FIRE_BALL_ATTACK);
 
-        m_game.emitter.add_projectile_effect(Particle::Effect::GAS, { m_position.x + 32, m_position.y + 32 },
-                                             { m_target->pos_x() + 32, m_target->pos_y() + 32 }, [this]() {
-                                                 m_target->damage(100000000);
-                                             });
+        if (auto target = m_game.map.entity(m_target); target != nullptr) {
+            auto x = target->center_x();
+            auto y = target->center_y();
+
+            // Walls stop the projectile short of the target.
+            m_game.map.raycast(center_x(), center_y(), x, y);
+
+            // The projectile may outlive both entities so only the caster's handle is captured.
+            m_game.emitter.add_projectile_effect(Particle::Effect::GAS, { center_x(), center_y() }, { x, y },
+                                                 [&game = m_game, caster = m_handle, x, y]() {
+                                                     game.combat.projectile(caster, x, y, 100000000);
+                                                 });
+        }
+
         start_animation();
         break;
     default:
         break;
     }
 
-    set_mana(m_mana - skill.mana_required());
+    set_mana(mana() - skill.mana_required());
 }
 
 void Entity::render(const SDL_Rect& camera)
@@ -896,8 +1094,8 @@ void Entity::render(const SDL_Rect& camera)
     // Render the 3x3 grid surrounding the character.
     // SDL_Rect rect;
 
-    // rect.x = ((m_position.x - camera.x) + MAP_TILE_SIZE) - MAP_TILE_SIZE / 2;
-    // rect.y = ((m_position.y - camera.y) + MAP_TILE_SIZE);
+    // rect.x = ((position_x() - camera.x) + MAP_TILE_SIZE) - MAP_TILE_SIZE / 2;
+    // rect.y = ((position_y() - camera.y) + MAP_TILE_SIZE);
 
     // rect.w = MAP_TILE_SIZE;
     // rect.h = MAP_TILE_SIZE;
@@ -931,10 +1129,10 @@ void Entity::render(const SDL_Rect& camera)
     //     }
     // }
 
-    m_virtual.x = (m_position.x - camera.x);
-    m_virtual.y = (m_position.z - camera.y);
+    m_virtual.x = (position_x() - camera.x);
+    m_virtual.y = (position_z() - camera.y);
 
-    switch (m_current_state) {
+    switch (current_state()) {
     case WIDE_SLASH_UP:
     case WIDE_SLASH_DOWN:
     case WIDE_SLASH_LEFT:
@@ -948,40 +1146,15 @@ void Entity::render(const SDL_Rect& camera)
     }
 
     // if (!m_player) {
-    // m_texture->set_alpha(200);
+    // texture()->set_alpha(200);
     // }
 
-    m_texture->render(m_virtual.x, m_virtual.y, &m_states[m_current_state][m_current_frame]);
-
-    if (m_damage_stack.empty()) {
-        return;
-    }
-
-    auto iter = m_damage_stack.begin();
-
-    while (iter != m_damage_stack.end()) {
-        auto& damage_texture = *iter;
-
-        if (damage_texture->alpha() <= 0) {
-            m_damage_stack.erase(iter);
-        } else {
-            // Render damage text above entity.
-            const auto damage_x = m_virtual.x + (CHARACTER_HORIZONTAL_CENTER - damage_texture->width() / 2);
-            const auto damage_y = m_virtual.y - ((255 - damage_texture->alpha()) / 10);
-
-            // Render scaled by damage magnitude.
-            damage_texture->render_transform(damage_x, damage_y);
-
-            // Make damage text progressively opaque.
-            // Will disappear after 17 frames (17 * 15 = 255).
-            damage_texture->set_alpha(std::max(0, damage_texture->alpha() - 15));
-
-            ++iter;
-        }
-    }
+    texture()->render(m_virtual.x, m_virtual.y, &m_states[current_state()][current_frame()]);
 }
 
 Entity::~Entity()
 {
     LOG_DEBUG << "Destroying entity: " << std::endl;
+
+    m_components.remove(m_index);
 }
@@ -7,16 +7,22 @@
 
 #include <SDL2/SDL.h>
 
+#include <array>
 #include <memory>
 #include <vector>
 
+#include "characters/animation.h"
+#include "characters/archetype.h"
+#include "characters/components.h"
 #include "characters/inventory.h"
 #include "characters/skill.h"
 #include "core/common.h"
 #include "core/logger.h"
 #include "core/math.h"
-#include "core/timer.h"
+#include "core/slot_map.h"
 #include "graphics/texture.h"
+#include "maps/pathfinder.h"
+#include "maps/search.h"
 
 class Game;
 
@@ -42,15 +48,6 @@ public:
         DOWN  = 1 << 3,
     };
 
-    // The sprite used by the entity.
-    enum Sprite
-    {
-        SPRITE_PLAYER            = 0,
-        SPRITE_BOAR_MAN          = 1,
-        SPRITE_BOAR_MAN_GUARDIAN = 2,
-        SPRITE_BOAR_MAN_BOSS     = 3,
-    };
-
 public:
     // Create a new entity of the given type for a game.
     explicit Entity(Type type, Game& game);
@@ -58,18 +55,34 @@ public:
     // Entity destructor.
     ~Entity();
 
+    Entity(const Entity&)            = delete;
+    Entity& operator=(const Entity&) = delete;
+
 public:
+    // Return the handle of the entity in the map storage.
+    Handle handle() const;
+
+    // Set the handle of the entity (only used by the map storage).
+    void set_handle(Handle handle);
+
+    // Return the index of the entity in the component arrays.
+    uint32_t component_index() const;
+
+    // Set the index of the entity in the component arrays (only used by the component storage).
+    void set_component_index(uint32_t index);
+
     // Return the id of the entity.
     int id() const;
 
     // Set the entity id.
     void set_id(int id);
 
-    // Set the current sprite for the entity.
-    bool set_sprite(Sprite sprite);
+    // Make the entity one of the archetypes (its sprite, stats and skills). Nothing changes if it
+    // already is one.
+    bool set_archetype(int id);
 
-    // Return the sprite of the entity.
-    Sprite sprite() const;
+    // Return the archetype of the entity (only valid once set).
+    const Archetype& archetype() const;
 
     // Return the inventory of the entity.
     const Inventory& inventory() const;
@@ -81,6 +94,19 @@ public:
     float pos_y() const;
     float pos_x() const;
 
+    // Return the height the character is drawn at (the y position lifted by the jump).
+    float pos_z() const;
+
+    // Return the x and y position of the center of the character.
+    float center_x() const;
+    float center_y() const;
+
+    // Return the spatial grid bucket the entity is stored in (-1 if none).
+    int grid_cell() const;
+
+    // Set the spatial grid bucket (only used by the spatial grid).
+    void set_grid_cell(int cell);
+
     int health() const;
     int health_bars() const;
     int max_health() const;
@@ -99,24 +125,54 @@ public:
 
     bool is_near_entity(Entity* entity);
 
+    // Find the nearest living entity (other than this one) within the given number of tiles.
+    Entity* find_target(int tile_range);
+
     // Update the position.
     void update(uint32_t ticks);
 
-    // Damage the entity.
+    // Damage the entity (the hits are dealt by Combat once every entity has been updated).
     void damage(int amount);
 
     // Render with camera.
     void render(const SDL_Rect& camera);
 
+    // Return the area of the map (in pixels) that render() may draw to, including the
+    // wide attack sprites and the damage text floating above the character.
+    SDL_Rect render_bounds() const;
+
+    // Return the last frame the entity was found visible (only used by the map renderer).
+    uint32_t render_frame() const;
+
+    // Set the last frame the entity was found visible.
+    void set_render_frame(uint32_t frame);
+
     // Check for collisions.
     void check_collision();
 
     /// Return true if entity is dead.
     bool dead() const;
 
-    // Walk to position.
+    // Walk to position (following a path around the walls).
     void walk_to_position(int x, int y);
 
+    // Stop following the current path (or the flow field) and drop any path requested in the background.
+    void stop_walking_to_position();
+
+    // Return true if walking to a position (or chasing).
+    bool walking() const;
+
+    // Walk towards another entity. If the map's flow field leads to the entity it is followed,
+    // otherwise a path is requested in the background whenever the entity changes tiles (the
+    // current path is followed until it arrives).
+    void chase(Entity* entity);
+
+    // Return the tile the entity is standing on.
+    SearchGraph::Cell cell() const;
+
+    // Return the tile under the bounding box for a sprite position.
+    static SearchGraph::Cell cell_at(float x, float y);
+
     // Set the position.
     void set_position(int x, int y);
 
@@ -132,6 +188,9 @@ public:
 
     void attack(Entity* entity);
 
+    // Hit the target of the attack (on the hit frame of the attack animation).
+    void strike();
+
     // Enable auto-attack.
     void auto_attack();
 
@@ -203,8 +262,28 @@ private:
     static const int CHARACTER_BOUNDING_BOX_TOP    = CHARACTER_HEIGHT / 2;
     static const int CHARACTER_BOUNDING_BOX_BOTTOM = CHARACTER_HEIGHT;
 
+    static const int BOUNDING_BOX_VERTICAL_CENTER = (CHARACTER_BOUNDING_BOX_TOP + CHARACTER_BOUNDING_BOX_BOTTOM) / 2;
+
+    // The size of the bounding box (in whole tiles).
+    static const int BOX_TILE_WIDTH  = (CHARACTER_BOUNDING_BOX_RIGHT - CHARACTER_BOUNDING_BOX_LEFT) / MAP_TILE_SIZE;
+    static const int BOX_TILE_HEIGHT = (CHARACTER_BOUNDING_BOX_BOTTOM - CHARACTER_BOUNDING_BOX_TOP) / MAP_TILE_SIZE;
+
+public:
+    // The size (in tiles) of the square a path has to keep free for the bounding box. Waypoints line
+    // the box up with the top left corner of a path tile and the collision checks probe its right and
+    // bottom edges, which fall on the next tiles.
+    static const int PATH_AGENT_SIZE = 1 + (BOX_TILE_WIDTH > BOX_TILE_HEIGHT ? BOX_TILE_WIDTH : BOX_TILE_HEIGHT);
+
+private:
     static const int JUMP_HEIGHT = CHARACTER_HEIGHT * 10;
 
+    // How close (in pixels) an intermediate waypoint has to be reached (it is passed as soon as a
+    // single step would reach it).
+    static const int WAYPOINT_TOLERANCE = 2;
+
+    // How close (in pixels) the end of a path has to be reached.
+    static constexpr float ARRIVAL_TOLERANCE = 0.5f;
+
     // Split the sprites into individual rectangles for clipping.
     static const std::vector<SDL_Rect> split(uint8_t index, uint8_t frames)
     {
@@ -237,31 +316,31 @@ private:
     static const std::array<std::vector<SDL_Rect>, 25>& states()
     {
         static const std::array<std::vector<SDL_Rect>, 25> clips = {
-            split(OPEN_ARMS_UP, 7),
-            split(OPEN_ARMS_LEFT, 7),
-            split(OPEN_ARMS_DOWN, 7),
-            split(OPEN_ARMS_RIGHT, 7),
-            split(SPEAR_ATTACK_UP, 8),
-            split(SPEAR_ATTACK_LEFT, 8),
-            split(SPEAR_ATTACK_DOWN, 8),
-            split(SPEAR_ATTACK_RIGHT, 8),
-            split(WALK_UP, 9),
-            split(WALK_LEFT, 9),
-            split(WALK_DOWN, 9),
-            split(WALK_RIGHT, 9),
-            split(SLASH_ATTACK_UP, 6),
-            split(SLASH_ATTACK_LEFT, 6),
-            split(SLASH_ATTACK_DOWN, 6),
-            split(SLASH_ATTACK_RIGHT, 6),
-            split(ARROW_ATTACK_UP, 13),
-            split(ARROW_ATTACK_LEFT, 13),
-            split(ARROW_ATTACK_DOWN, 13),
-            split(ARROW_ATTACK_RIGHT, 13),
-            split(FALL, 6),
-            split_wide(WIDE_SLASH_UP, 6),
-            split_wide(WIDE_SLASH_LEFT, 6),
-            split_wide(WIDE_SLASH_DOWN, 6),
-            split_wide(WIDE_SLASH_RIGHT, 6),
+            split(OPEN_ARMS_UP, AnimationEvent::FRAME_COUNTS[AnimationEvent::OPEN_ARMS]),
+            split(OPEN_ARMS_LEFT, AnimationEvent::FRAME_COUNTS[AnimationEvent::OPEN_ARMS]),
+            split(OPEN_ARMS_DOWN, AnimationEvent::FRAME_COUNTS[AnimationEvent::OPEN_ARMS]),
+            split(OPEN_ARMS_RIGHT, AnimationEvent::FRAME_COUNTS[AnimationEvent::OPEN_ARMS]),
+            split(SPEAR_ATTACK_UP, AnimationEvent::FRAME_COUNTS[AnimationEvent::SPEAR_ATTACK]),
+            split(SPEAR_ATTACK_LEFT, AnimationEvent::FRAME_COUNTS[AnimationEvent::SPEAR_ATTACK]),
+            split(SPEAR_ATTACK_DOWN, AnimationEvent::FRAME_COUNTS[AnimationEvent::SPEAR_ATTACK]),
+            split(SPEAR_ATTACK_RIGHT, AnimationEvent::FRAME_COUNTS[AnimationEvent::SPEAR_ATTACK]),
+            split(WALK_UP, AnimationEvent::FRAME_COUNTS[AnimationEvent::WALK]),
+            split(WALK_LEFT, AnimationEvent::FRAME_COUNTS[AnimationEvent::WALK]),
+            split(WALK_DOWN, AnimationEvent::FRAME_COUNTS[AnimationEvent::WALK]),
+            split(WALK_RIGHT, AnimationEvent::FRAME_COUNTS[AnimationEvent::WALK]),
+            split(SLASH_ATTACK_UP, AnimationEvent::FRAME_COUNTS[AnimationEvent::SLASH]),
+            split(SLASH_ATTACK_LEFT, AnimationEvent::FRAME_COUNTS[AnimationEvent::SLASH]),
+            split(SLASH_ATTACK_DOWN, AnimationEvent::FRAME_COUNTS[AnimationEvent::SLASH]),
+            split(SLASH_ATTACK_RIGHT, AnimationEvent::FRAME_COUNTS[AnimationEvent::SLASH]),
+            split(ARROW_ATTACK_UP, AnimationEvent::FRAME_COUNTS[AnimationEvent::ARROW_ATTACK]),
+            split(ARROW_ATTACK_LEFT, AnimationEvent::FRAME_COUNTS[AnimationEvent::ARROW_ATTACK]),
+            split(ARROW_ATTACK_DOWN, AnimationEvent::FRAME_COUNTS[AnimationEvent::ARROW_ATTACK]),
+            split(ARROW_ATTACK_RIGHT, AnimationEvent::FRAME_COUNTS[AnimationEvent::ARROW_ATTACK]),
+            split(FALL, AnimationEvent::FRAME_COUNTS[AnimationEvent::FALL]),
+            split_wide(WIDE_SLASH_UP, AnimationEvent::FRAME_COUNTS[AnimationEvent::WIDE_SLASH]),
+            split_wide(WIDE_SLASH_LEFT, AnimationEvent::FRAME_COUNTS[AnimationEvent::WIDE_SLASH]),
+            split_wide(WIDE_SLASH_DOWN, AnimationEvent::FRAME_COUNTS[AnimationEvent::WIDE_SLASH]),
+            split_wide(WIDE_SLASH_RIGHT, AnimationEvent::FRAME_COUNTS[AnimationEvent::WIDE_SLASH]),
         };
 
         return clips;
@@ -273,39 +352,122 @@ private:
     void start_animation();
     void stop_animation();
     void face_towards_entity(Entity* entity);
-    void finish_jump();
 
     void set_action(Action action);
 
-private:
-    Vector3D<float> m_position;
-    Vector3D<float> m_velocity;
-    Vector3D<float> m_acceleration;
-    Vector2D<int>   m_virtual;
+    // Fire the events of the frames the animation has reached since the last update.
+    void fire_animation_events(uint32_t played);
 
-    int m_health;
-    int m_health_bars;
-    int m_max_health;
+    // Return the animation a state is part of.
+    static AnimationEvent::Animation animation_of(uint8_t state);
 
-    int m_mana;
-    int m_mana_bars;
-    int m_max_mana;
+    // Return the sprite position for a waypoint of the current path.
+    Vector2D<int> waypoint(size_t index) const;
 
-    int m_stamina;
-    int m_stamina_bars;
-    int m_max_stamina;
+    // Start walking along the current path.
+    void follow_path();
 
-    float m_speed;
-    int   m_max_speed;
+    // Drop the path requested in the background (if any).
+    void cancel_path_request();
 
-    Texture* m_texture;
+    // The state kept in the component arrays.
+    float& position_x() const
+    {
+        return m_components.motion.position_x[m_index];
+    }
 
-    const std::array<std::vector<SDL_Rect>, 25>& m_states;
-    int                                          m_current_state;
+    float& position_y() const
+    {
+        return m_components.motion.position_y[m_index];
+    }
+
+    float& position_z() const
+    {
+        return m_components.motion.position_z[m_index];
+    }
+
+    float& velocity_x() const
+    {
+        return m_components.motion.velocity_x[m_index];
+    }
+
+    float& velocity_y() const
+    {
+        return m_components.motion.velocity_y[m_index];
+    }
+
+    float& velocity_z() const
+    {
+        return m_components.motion.velocity_z[m_index];
+    }
+
+    float& acceleration_z() const
+    {
+        return m_components.motion.acceleration_z[m_index];
+    }
+
+    float& speed() const
+    {
+        return m_components.motion.speed[m_index];
+    }
 
-    size_t m_current_frame;
+    float& max_speed() const
+    {
+        return m_components.motion.max_speed[m_index];
+    }
 
-    Timer m_timer;
+    float& elapsed() const
+    {
+        return m_components.motion.elapsed[m_index];
+    }
+
+    uint8_t& jumping() const
+    {
+        return m_components.motion.jumping[m_index];
+    }
+
+    uint8_t& paused() const
+    {
+        return m_components.motion.paused[m_index];
+    }
+
+    uint8_t& current_state() const
+    {
+        return m_components.animation.state[m_index];
+    }
+
+    uint16_t& current_frame() const
+    {
+        return m_components.animation.frame[m_index];
+    }
+
+    uint16_t& animation_rate() const
+    {
+        return m_components.animation.rate[m_index];
+    }
+
+    uint8_t& animation_playing() const
+    {
+        return m_components.animation.playing[m_index];
+    }
+
+    uint32_t& animation_fired() const
+    {
+        return m_components.animation.fired[m_index];
+    }
+
+    Texture*& texture() const
+    {
+        return m_components.render.texture[m_index];
+    }
+
+private:
+    Components& m_components;
+    uint32_t    m_index;
+
+    Vector2D<int> m_virtual;
+
+    const std::array<std::vector<SDL_Rect>, 25>& m_states;
 
     int       m_movement_direction;
     Direction m_sprite_direction;
@@ -319,25 +481,27 @@ private:
 
     Type m_type;
 
-    int m_attack_long_range;
-    int m_attack_short_range;
-
-    int m_attack_power;
-
-    Entity* m_target;
+    Handle m_handle;
+    Handle m_target;
 
     Vector2D<int> m_destination;
     bool          m_walking_to_destination;
 
-    bool m_jumping;
+    Vector2D<int>                  m_final_destination;
+    std::vector<SearchGraph::Cell> m_path;
+    size_t                         m_path_index;
+    bool                           m_path_found;
+    SearchGraph::Cell              m_chase_cell;
+    Vector2D<int>                  m_chase_destination;
+    bool                           m_following_flow;
 
-    Inventory m_inventory;
+    std::shared_ptr<const Pathfinder::Ticket> m_path_ticket;
 
-    int m_animation_rate;
+    Inventory m_inventory;
 
     std::vector<Skill> m_skills;
 
-    std::vector<std::unique_ptr<Texture>> m_damage_stack;
+    const Archetype* m_archetype;
 
-    Sprite m_sprite;
+    int m_grid_cell;
 };
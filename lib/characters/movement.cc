@@ -0,0 +1,375 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "characters/movement.h"
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "core/common.h"
+
+// The highest positions that keep the character on the map.
+static const float MAX_X = MAP_WIDTH - CHARACTER_WIDTH;
+static const float MAX_Y = MAP_HEIGHT - CHARACTER_HEIGHT;
+
+#if defined(__AVX__)
+
+// 8 lanes of AVX.
+struct Batch
+{
+    using Float = __m256;
+
+    static const int WIDTH = 8;
+
+    static Float load(const float* p)
+    {
+        return _mm256_loadu_ps(p);
+    }
+
+    static void store(float* p, Float v)
+    {
+        _mm256_storeu_ps(p, v);
+    }
+
+    static Float set(float f)
+    {
+        return _mm256_set1_ps(f);
+    }
+
+    // Return a mask of the lanes whose flag is set.
+    static Float load_flags(const uint8_t* p)
+    {
+        int64_t bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+
+        const auto zero  = _mm_setzero_si128();
+        const auto words = _mm_unpacklo_epi8(_mm_cvtsi64_si128(bytes), zero);
+        const auto low   = _mm_cmpgt_epi32(_mm_unpacklo_epi16(words, zero), zero);
+        const auto high  = _mm_cmpgt_epi32(_mm_unpackhi_epi16(words, zero), zero);
+
+        return _mm256_castsi256_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(low), high, 1));
+    }
+
+    static Float add(Float a, Float b)
+    {
+        return _mm256_add_ps(a, b);
+    }
+
+    static Float mul(Float a, Float b)
+    {
+        return _mm256_mul_ps(a, b);
+    }
+
+    static Float min(Float a, Float b)
+    {
+        return _mm256_min_ps(a, b);
+    }
+
+    static Float max(Float a, Float b)
+    {
+        return _mm256_max_ps(a, b);
+    }
+
+    static Float less(Float a, Float b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+    }
+
+    static Float greater_equal(Float a, Float b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+    }
+
+    static Float equal(Float a, Float b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+    }
+
+    static Float both(Float a, Float b)
+    {
+        return _mm256_and_ps(a, b);
+    }
+
+    // Return a and not b.
+    static Float except(Float a, Float b)
+    {
+        return _mm256_andnot_ps(b, a);
+    }
+
+    // Return b in the lanes of the mask and a in the others.
+    static Float select(Float a, Float b, Float mask)
+    {
+        return _mm256_blendv_ps(a, b, mask);
+    }
+
+    static int bits(Float mask)
+    {
+        return _mm256_movemask_ps(mask);
+    }
+};
+
+#elif defined(__SSE2__)
+
+// 4 lanes of SSE2.
+struct Batch
+{
+    using Float = __m128;
+
+    static const int WIDTH = 4;
+
+    static Float load(const float* p)
+    {
+        return _mm_loadu_ps(p);
+    }
+
+    static void store(float* p, Float v)
+    {
+        _mm_storeu_ps(p, v);
+    }
+
+    static Float set(float f)
+    {
+        return _mm_set1_ps(f);
+    }
+
+    // Return a mask of the lanes whose flag is set.
+    static Float load_flags(const uint8_t* p)
+    {
+        int32_t bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+
+        const auto zero  = _mm_setzero_si128();
+        const auto words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero);
+
+        return _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_unpacklo_epi16(words, zero), zero));
+    }
+
+    static Float add(Float a, Float b)
+    {
+        return _mm_add_ps(a, b);
+    }
+
+    static Float mul(Float a, Float b)
+    {
+        return _mm_mul_ps(a, b);
+    }
+
+    static Float min(Float a, Float b)
+    {
+        return _mm_min_ps(a, b);
+    }
+
+    static Float max(Float a, Float b)
+    {
+        return _mm_max_ps(a, b);
+    }
+
+    static Float less(Float a, Float b)
+    {
+        return _mm_cmplt_ps(a, b);
+    }
+
+    static Float greater_equal(Float a, Float b)
+    {
+        return _mm_cmpge_ps(a, b);
+    }
+
+    static Float equal(Float a, Float b)
+    {
+        return _mm_cmpeq_ps(a, b);
+    }
+
+    static Float both(Float a, Float b)
+    {
+        return _mm_and_ps(a, b);
+    }
+
+    // Return a and not b.
+    static Float except(Float a, Float b)
+    {
+        return _mm_andnot_ps(b, a);
+    }
+
+    // Return b in the lanes of the mask and a in the others.
+    static Float select(Float a, Float b, Float mask)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+    }
+
+    static int bits(Float mask)
+    {
+        return _mm_movemask_ps(mask);
+    }
+};
+
+#endif
+
+#if defined(__AVX__) || defined(__SSE2__)
+
+// Clamp a coordinate to 0..limit (in the same order as the scalar kernel: the sum is compared
+// against the map size rather than the position against the limit, so both round the same way).
+static Batch::Float keep_on_map(Batch::Float position, float size, float map_size)
+{
+    const auto zero = Batch::set(0.0f);
+
+    const auto beyond = Batch::except(Batch::less(Batch::set(map_size), Batch::add(position, Batch::set(size))),
+                                      Batch::less(position, zero));
+
+    position = Batch::select(position, zero, Batch::less(position, zero));
+
+    return Batch::select(position, Batch::set(map_size - size), beyond);
+}
+
+// Move one batch of entities starting at index.
+static void integrate_batch(Components::Motion& m, size_t i, std::vector<uint32_t>& landed)
+{
+    const auto zero = Batch::set(0.0f);
+    const auto dt   = Batch::load(&m.elapsed[i]);
+
+    auto vx = Batch::load(&m.velocity_x[i]);
+    auto vy = Batch::load(&m.velocity_y[i]);
+    auto vz = Batch::load(&m.velocity_z[i]);
+
+    // Paused entities and entities standing still are left alone.
+    const auto all    = Batch::equal(zero, zero);
+    const auto still  = Batch::both(Batch::equal(vx, zero), Batch::equal(vy, zero));
+    const auto moving = Batch::except(Batch::except(all, Batch::both(still, Batch::equal(vz, zero))),
+                                      Batch::load_flags(&m.paused[i]));
+
+    if (Batch::bits(moving) == 0) {
+        return;
+    }
+
+    // Do not exceed maximum speed.
+    const auto max_speed = Batch::load(&m.max_speed[i]);
+    const auto min_speed = Batch::mul(max_speed, Batch::set(-1.0f));
+
+    vx = Batch::min(Batch::max(vx, min_speed), max_speed);
+    vy = Batch::min(Batch::max(vy, min_speed), max_speed);
+
+    const auto x  = Batch::load(&m.position_x[i]);
+    const auto y  = Batch::load(&m.position_y[i]);
+    const auto z  = Batch::load(&m.position_z[i]);
+    const auto az = Batch::load(&m.acceleration_z[i]);
+
+    const auto new_x = keep_on_map(Batch::add(x, Batch::mul(vx, dt)), CHARACTER_WIDTH, MAP_WIDTH);
+    const auto new_y = keep_on_map(Batch::add(y, Batch::mul(vy, dt)), CHARACTER_HEIGHT, MAP_HEIGHT);
+
+    // Off the ground the height follows the jump, otherwise it follows the ground.
+    const auto jumping = Batch::load_flags(&m.jumping[i]);
+    const auto air_z   = keep_on_map(Batch::add(z, Batch::mul(vz, dt)), CHARACTER_HEIGHT, MAP_HEIGHT);
+    const auto down    = Batch::both(Batch::both(jumping, moving), Batch::greater_equal(air_z, new_y));
+    const auto rising  = Batch::except(jumping, down);
+
+    auto new_z  = Batch::select(new_y, air_z, rising);
+    auto new_vz = Batch::select(vz, Batch::add(vz, Batch::mul(az, dt)), rising);
+
+    new_vz = Batch::select(new_vz, zero, down);
+
+    Batch::store(&m.velocity_x[i], Batch::select(Batch::load(&m.velocity_x[i]), vx, moving));
+    Batch::store(&m.velocity_y[i], Batch::select(Batch::load(&m.velocity_y[i]), vy, moving));
+    Batch::store(&m.velocity_z[i], Batch::select(vz, new_vz, moving));
+    Batch::store(&m.position_x[i], Batch::select(x, new_x, moving));
+    Batch::store(&m.position_y[i], Batch::select(y, new_y, moving));
+    Batch::store(&m.position_z[i], Batch::select(z, new_z, moving));
+
+    // On the ground again (rare enough to finish one at a time).
+    for (auto bits = Batch::bits(down); bits != 0; bits &= bits - 1) {
+        const auto index = static_cast<uint32_t>(i + std::countr_zero(static_cast<unsigned>(bits)));
+
+        m.jumping[index] = false;
+        landed.push_back(index);
+    }
+}
+
+#endif
+
+void integrate_motion(Components::Motion& motion, size_t count, std::vector<uint32_t>& landed)
+{
+    size_t i = 0;
+
+#if defined(__AVX__) || defined(__SSE2__)
+    for (; i + Batch::WIDTH <= count; i += Batch::WIDTH) {
+        integrate_batch(motion, i, landed);
+    }
+#endif
+
+    integrate_motion_scalar(motion, i, count, landed);
+}
+
+void integrate_motion_scalar(Components::Motion& motion, size_t begin, size_t end, std::vector<uint32_t>& landed)
+{
+    auto& m = motion;
+
+    for (auto i = begin; i < end; ++i) {
+        const auto dt = m.elapsed[i];
+
+        // Entity has stopped moving.
+        if (m.paused[i] || (m.velocity_x[i] == 0.0f && m.velocity_y[i] == 0.0f && m.velocity_z[i] == 0.0f)) {
+            continue;
+        }
+
+        // Do not exceed maximum speed.
+        m.velocity_x[i] = std::clamp(m.velocity_x[i], -m.max_speed[i], m.max_speed[i]);
+        m.velocity_y[i] = std::clamp(m.velocity_y[i], -m.max_speed[i], m.max_speed[i]);
+
+        m.position_x[i] += m.velocity_x[i] * dt;
+
+        if (m.position_x[i] < 0) {
+            m.position_x[i] = 0;
+        } else if (m.position_x[i] + CHARACTER_WIDTH > MAP_WIDTH) {
+            m.position_x[i] = MAX_X;
+        }
+
+        m.position_y[i] += m.velocity_y[i] * dt;
+
+        if (m.position_y[i] < 0) {
+            m.position_y[i] = 0;
+        } else if (m.position_y[i] + CHARACTER_HEIGHT > MAP_HEIGHT) {
+            m.position_y[i] = MAX_Y;
+        }
+
+        if (!m.jumping[i]) {
+            m.position_z[i] = m.position_y[i];
+            continue;
+        }
+
+        m.position_z[i] += m.velocity_z[i] * dt;
+
+        if (m.position_z[i] < 0) {
+            m.position_z[i] = 0;
+        } else if (m.position_z[i] + CHARACTER_HEIGHT > MAP_HEIGHT) {
+            m.position_z[i] = MAX_Y;
+        }
+
+        if (m.position_z[i] < m.position_y[i]) {
+            m.velocity_z[i] += m.acceleration_z[i] * dt;
+            continue;
+        }
+
+        // On the ground again.
+        m.jumping[i]    = false;
+        m.position_z[i] = m.position_y[i];
+        m.velocity_z[i] = 0;
+
+        landed.push_back(i);
+    }
+}
+
+const char* integrate_motion_isa()
+{
+#if defined(__AVX__)
+    return "avx";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
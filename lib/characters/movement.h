@@ -0,0 +1,29 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "characters/components.h"
+
+// The movement kernel moves a range of entities by their velocity over their elapsed time: the speed is
+// clamped to the maximum, the position is kept on the map and the height follows the jump arc.
+// Entities that are paused or not moving at all are left alone. The indices of the entities that
+// came down from a jump this step are appended to landed (their jumping flag is cleared, the rest
+// of the landing is up to the caller).
+//
+// integrate_motion() runs over 8 entities at a time with AVX or 4 with SSE2 (whichever the build
+// targets), turning every branch into a masked blend, and finishes the remainder with the scalar
+// kernel. Both give the same results.
+void integrate_motion(Components::Motion& motion, size_t count, std::vector<uint32_t>& landed);
+
+// The scalar movement kernel over the entities from begin up to end.
+void integrate_motion_scalar(Components::Motion& motion, size_t begin, size_t end, std::vector<uint32_t>& landed);
+
+// Return the name of the instruction set used by integrate_motion().
+const char* integrate_motion_isa();
@@ -51,6 +51,9 @@ static const auto BAR_COUNT = 14;
 // Number of available slots.
 static const auto SLOTS_AVAILABLE = 14;
 
+// Number of skill slots on the bar (keys 1 to 9 and 0).
+static const auto SKILL_SLOT_COUNT = 10;
+
 // Tiled tile flags.
 const unsigned FLIPPED_HORIZONTALLY_FLAG = 0x80000000;
 const unsigned FLIPPED_VERTICALLY_FLAG   = 0x40000000;
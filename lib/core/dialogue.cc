@@ -234,6 +234,9 @@ void Dialogue::play_notice(Notice notice)
     case FIRE_BALL_ATTACK:
         add_text(Narrator::NONE, { "Fire Ball! Burn thy enemies to dust!" });
         break;
+    case ENEMY_DEFEATED:
+        add_text(Narrator::NONE, { "Your enemy has fallen!" });
+        break;
     case PICK_UP_GOLD:
         add_text(Narrator::NONE, { "Try to do your best today, okay?" });
         break;
@@ -34,6 +34,7 @@ public:
         ENTER_LEVEL_4,
         ENTER_LEVEL_5,
         FIRE_BALL_ATTACK,
+        ENEMY_DEFEATED,
     };
 
     // An exchange is an uninterruptible sequence of messages. The player will not
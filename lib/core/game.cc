@@ -14,16 +14,20 @@
 
 #include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <ostream>
 #include <sstream>
 
 #include "core/common.h"
 #include "core/logger.h"
+#include "core/stress.h"
 
 Game::Game()
   : map(*this, m_player)
   , dialogue(*this)
   , emitter(*this)
+  , combat_text(*this)
+  , combat(*this)
   , m_frame_rate(60)
   , m_fps_delta(1000 / 60)
   , m_running(false)
@@ -35,6 +39,8 @@ Game::Game()
   , m_transition_alpha(255)
   , m_menu_visible(true)
   , m_profile_visible(false)
+  , m_stress_enemies(0)
+  , m_stress_frames(0)
 {
     m_health_clip  = { 0, 0, 8, 12 };
     m_mana_clip    = { 0, 12, 8, 12 };
@@ -60,6 +66,12 @@ bool Game::initialize()
         storage.AddMember("menu_visible", true, storage.GetAllocator());
     }
 
+    // Every kind of entity is defined in a data file.
+    if (!archetypes.load(RESOLVE_DATA("definitions"))) {
+        LOG_ERROR << "Failed to load archetypes" << std::endl;
+        return false;
+    }
+
     // Check if audio is muted.
     audio.set_enabled(storage["mute_audio"].GetBool());
 
@@ -140,37 +152,22 @@ const char* Game::app_name() const
     return m_app_name;
 }
 
-Texture* Game::get_entity_texture(Entity::Sprite sprite)
+Texture* Game::get_entity_texture(const Archetype& archetype)
 {
-    if (m_entity_textures.contains(sprite)) {
-        return &m_entity_textures[sprite];
+    if (auto iter = m_entity_textures.find(archetype.id); iter != m_entity_textures.end()) {
+        return &iter->second;
     }
 
-    const char* path_to_sheet;
-
-    switch (sprite) {
-    case Entity::SPRITE_PLAYER:
-        path_to_sheet = RESOLVE_RESOURCE("images/characters/sprites/player-4.png");
-        break;
-    case Entity::SPRITE_BOAR_MAN:
-        path_to_sheet = RESOLVE_RESOURCE("images/characters/sprites/bull-guardian.png");
-        break;
-    case Entity::SPRITE_BOAR_MAN_GUARDIAN:
-        path_to_sheet = RESOLVE_RESOURCE("images/characters/sprites/player-2.png");
-        break;
-    case Entity::SPRITE_BOAR_MAN_BOSS:
-        path_to_sheet = RESOLVE_RESOURCE("images/characters/sprites/player-5.png");
-        break;
-    }
+    const auto path_to_sheet = std::string(RESOURCE_FOLDER "/") + archetype.sprite_sheet;
 
-    m_entity_textures[sprite] = Texture();
+    if (!m_entity_textures[archetype.id].load(window.renderer(), path_to_sheet.c_str())) {
+        LOG_ERROR << "Failed to load entity texture: " << path_to_sheet << std::endl;
 
-    if (!m_entity_textures[sprite].load(window.renderer(), path_to_sheet)) {
-        LOG_ERROR << "Failed to load entity texture" << std::endl;
+        m_entity_textures.erase(archetype.id);
         return nullptr;
     }
 
-    return &m_entity_textures[sprite];
+    return &m_entity_textures[archetype.id];
 }
 
 int Game::start()
@@ -190,7 +187,7 @@ int Game::start()
         return EXIT_FAILURE;
     }
 
-    if (audio.enabled()) {
+    if (audio.enabled() && m_stress_enemies == 0) {
         audio.play_sound_track(Audio::SoundTrack::DARK_BLUE);
     }
 
@@ -204,6 +201,11 @@ int Game::start()
         return false;
     }
 
+    if (!combat_text.initialize()) {
+        LOG_ERROR << "Failed to initialize combat text" << std::endl;
+        return false;
+    }
+
     if (!dialogue.initialize()) {
         LOG_ERROR << "Failed to initialized dialogue" << std::endl;
         return false;
@@ -263,6 +265,12 @@ int Game::start()
 
     SDL_SetCursor(m_up_cursor);
 
+    if (m_stress_enemies > 0) {
+        StressTest test(*this, m_player, m_stress_enemies, m_stress_frames);
+
+        return test.run(m_fps_delta, std::cout) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     // Start game loop...
     while (m_running) {
         tick();
@@ -271,6 +279,12 @@ int Game::start()
     return EXIT_SUCCESS;
 }
 
+void Game::set_stress_test(int enemies, int frames)
+{
+    m_stress_enemies = enemies;
+    m_stress_frames  = frames;
+}
+
 TTF_Font* Game::font() const
 {
     return m_font;
@@ -351,24 +365,17 @@ void Game::tick()
     SDL_RenderClear(window.renderer());
 
     // Update player logic.
-    for (auto& entity : map.entities()) {
-        entity->check_collision();
-        entity->update(m_physics_timer.ticks());
-
-        // if (!entity->is_player()) {
-        //     if (entity->is_near_entity(&m_player)) {
-        //         entity->attack(&m_player);
-        //     } else {
-        //         if (entity->attacking()) {
-        //             entity->stop_attacking();
-        //         }
-        //     }
-        // }
-    }
+    map.update(m_physics_timer.ticks());
 
     // Update the particle effects.
     emitter.update(m_physics_timer.ticks());
 
+    // Deal the damage of the hits from this tick.
+    combat.resolve();
+
+    // Update the floating combat text.
+    combat_text.update(m_physics_timer.ticks());
+
     // Render the map layer.
     map.render();
 
@@ -560,7 +567,7 @@ void Game::handle_key_up()
         m_player.use_skill(8);
         break;
     case SDLK_0:
-        m_player.use_skill(10);
+        m_player.use_skill(9);
         break;
     case SDLK_p:
         m_menu_visible = true;
@@ -11,6 +11,8 @@
 #include <unordered_map>
 
 #include "audio/audio.h"
+#include "characters/archetype.h"
+#include "characters/combat.h"
 #include "characters/entity.h"
 #include "core/common.h"
 #include "core/dialogue.h"
@@ -18,6 +20,7 @@
 #include "graphics/texture.h"
 #include "graphics/window.h"
 #include "maps/map.h"
+#include "particles/combat_text.h"
 #include "particles/emitter.h"
 #include "storage/storage.h"
 
@@ -34,12 +37,15 @@ public:
     void        set_app_name(const char* name);
     bool        initialize();
     bool        running() const;
-    Texture*    get_entity_texture(Entity::Sprite sprite);
+    Texture*    get_entity_texture(const Archetype& archetype);
     int         start();
     void        quit();
     TTF_Font*   font() const;
     SDL_Cursor* create_cursor(const char* file_name);
 
+    // Run a stress test instead of the game (0 enemies for the game).
+    void set_stress_test(int enemies, int frames);
+
 public:
     // The window controller.
     Window window;
@@ -50,6 +56,9 @@ public:
     // The storage controller.
     Storage storage;
 
+    // The entity archetypes.
+    Archetypes archetypes;
+
     // The map controller.
     Map map;
 
@@ -59,6 +68,12 @@ public:
     // The particles controller.
     Emitter emitter;
 
+    // The combat text controller.
+    CombatText combat_text;
+
+    // The combat controller (resolves the hits of a tick).
+    Combat combat;
+
 private:
     void tick();
 
@@ -92,7 +107,7 @@ private:
     Texture m_profile_texture;
     Texture m_profile_text_texture;
 
-    std::unordered_map<Entity::Sprite, Texture> m_entity_textures;
+    std::unordered_map<int, Texture> m_entity_textures;
 
     SDL_Rect m_health_clip;
     SDL_Rect m_mana_clip;
@@ -112,4 +127,7 @@ private:
 
     bool m_menu_visible;
     bool m_profile_visible;
+
+    int m_stress_enemies;
+    int m_stress_frames;
 };
@@ -0,0 +1,202 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Handle is a stable reference to an object stored in a SlotMap. Every time a slot is
+// reused its generation is bumped so that handles to removed objects stop resolving.
+struct Handle
+{
+    uint32_t index      = 0;
+    uint32_t generation = 0;
+
+    // Return true if the handle has been assigned (it may still refer to a removed object).
+    bool valid() const
+    {
+        return generation != 0;
+    }
+
+    bool operator==(const Handle& other) const = default;
+};
+
+// SlotMap stores objects in pooled chunks so that their addresses never change and slots
+// are recycled without going back to the heap. Lookups by handle, insertion and removal
+// are O(1) and the live objects can be iterated as a dense array.
+template<typename T, size_t CHUNK_SIZE = 256>
+class SlotMap
+{
+public:
+    // Create an empty slot map.
+    explicit SlotMap() = default;
+
+    // Destroy all of the objects owned by the slot map.
+    ~SlotMap()
+    {
+        clear();
+    }
+
+    SlotMap(const SlotMap&)            = delete;
+    SlotMap& operator=(const SlotMap&) = delete;
+
+public:
+    // Construct a new object in a free slot and return its handle.
+    template<typename... Args>
+    Handle emplace(Args&&... args)
+    {
+        auto& slot = acquire();
+
+        slot.object = new (slot.storage) T(std::forward<Args>(args)...);
+        slot.owned  = true;
+
+        return push(slot);
+    }
+
+    // Store an object that is owned (and destroyed) by someone else.
+    Handle attach(T& object)
+    {
+        auto& slot = acquire();
+
+        slot.object = &object;
+        slot.owned  = false;
+
+        return push(slot);
+    }
+
+    // Remove the object referred to by the handle (does nothing if it has already been removed).
+    void erase(Handle handle)
+    {
+        auto slot = find(handle);
+
+        if (slot == nullptr) {
+            return;
+        }
+
+        // Keep the dense array packed by moving the last object into the hole.
+        const auto dense_index = slot->dense_index;
+
+        m_dense[dense_index]       = m_dense.back();
+        m_dense_slots[dense_index] = m_dense_slots.back();
+
+        at(m_dense_slots[dense_index]).dense_index = dense_index;
+
+        m_dense.pop_back();
+        m_dense_slots.pop_back();
+
+        if (slot->owned) {
+            slot->object->~T();
+        }
+
+        slot->object = nullptr;
+
+        // Invalidate all outstanding handles (zero is reserved for unassigned handles).
+        if (++slot->generation == 0) {
+            slot->generation = 1;
+        }
+
+        m_free.push_back(handle.index);
+    }
+
+    // Remove all objects. The chunks are kept for reuse.
+    void clear()
+    {
+        while (!m_dense_slots.empty()) {
+            const auto index = m_dense_slots.back();
+            erase({ index, at(index).generation });
+        }
+    }
+
+    // Return the object referred to by the handle or nullptr if it has been removed.
+    T* get(Handle handle) const
+    {
+        auto slot = find(handle);
+        return slot == nullptr ? nullptr : slot->object;
+    }
+
+    // Return the number of objects stored.
+    size_t size() const
+    {
+        return m_dense.size();
+    }
+
+    // Return the objects as a dense array (the order changes when objects are removed).
+    const std::vector<T*>& objects() const
+    {
+        return m_dense;
+    }
+
+private:
+    struct Slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T*       object      = nullptr;
+        uint32_t generation  = 1;
+        uint32_t dense_index = 0;
+        bool     owned       = false;
+    };
+
+    Slot& at(uint32_t index) const
+    {
+        return m_chunks[index / CHUNK_SIZE][index % CHUNK_SIZE];
+    }
+
+    Slot* find(Handle handle) const
+    {
+        if (handle.index >= m_chunks.size() * CHUNK_SIZE) {
+            return nullptr;
+        }
+
+        auto& slot = at(handle.index);
+
+        if (slot.object == nullptr || slot.generation != handle.generation) {
+            return nullptr;
+        }
+
+        return &slot;
+    }
+
+    // Take a slot from the free list (allocating a new chunk if there are none left).
+    Slot& acquire()
+    {
+        if (m_free.empty()) {
+            const auto first = static_cast<uint32_t>(m_chunks.size() * CHUNK_SIZE);
+
+            m_chunks.push_back(std::make_unique<Slot[]>(CHUNK_SIZE));
+
+            // Hand out the lowest indices first.
+            for (auto i = CHUNK_SIZE; i > 0; --i) {
+                m_free.push_back(first + i - 1);
+            }
+        }
+
+        m_acquired = m_free.back();
+        m_free.pop_back();
+
+        return at(m_acquired);
+    }
+
+    Handle push(Slot& slot)
+    {
+        slot.dense_index = m_dense.size();
+
+        m_dense.push_back(slot.object);
+        m_dense_slots.push_back(m_acquired);
+
+        return { m_acquired, slot.generation };
+    }
+
+private:
+    std::vector<std::unique_ptr<Slot[]>> m_chunks;
+    std::vector<uint32_t>                m_free;
+    std::vector<T*>                      m_dense;
+    std::vector<uint32_t>                m_dense_slots;
+    uint32_t                             m_acquired = 0;
+};
@@ -0,0 +1,287 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "core/stress.h"
+
+#include <rapidjson/ostreamwrapper.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "core/common.h"
+#include "core/game.h"
+#include "core/logger.h"
+
+using Writer = rapidjson::Writer<rapidjson::OStreamWrapper>;
+using Clock  = std::chrono::steady_clock;
+
+// The number of frames between two orders given to the same enemy.
+static const int ORDER_INTERVAL = 60;
+
+// One order in this many is an attack (the others are walks).
+static const int ATTACK_RATIO = 4;
+
+// How far (in tiles) an enemy walks from where it stands.
+static const int WALK_RADIUS = 8;
+
+// The number of random tiles tried before giving up on finding a free one.
+static const int PLACEMENT_TRIES = 64;
+
+// Return the time between two points in milliseconds.
+static double milliseconds(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Return a percentile (0 to 100) of sorted samples (nearest rank).
+static double percentile(const std::vector<double>& samples, int p)
+{
+    if (samples.empty()) {
+        return 0;
+    }
+
+    const auto rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+
+    return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+}
+
+// Write the distribution of samples as a JSON object (the samples are sorted in place).
+static void write_distribution(Writer& writer, const char* name, std::vector<double>& samples)
+{
+    std::sort(samples.begin(), samples.end());
+
+    double total = 0;
+
+    for (auto sample : samples) {
+        total += sample;
+    }
+
+    writer.Key(name);
+    writer.StartObject();
+    writer.Key("mean");
+    writer.Double(samples.empty() ? 0 : total / samples.size());
+    writer.Key("p50");
+    writer.Double(percentile(samples, 50));
+    writer.Key("p90");
+    writer.Double(percentile(samples, 90));
+    writer.Key("p99");
+    writer.Double(percentile(samples, 99));
+    writer.Key("max");
+    writer.Double(samples.empty() ? 0 : samples.back());
+    writer.EndObject();
+}
+
+StressTest::StressTest(Game& game, Entity& player, int enemies, int frames, uint32_t seed)
+  : m_game(game)
+  , m_player(player)
+  , m_enemies(enemies)
+  , m_frames(frames)
+  , m_rng(seed)
+{
+}
+
+bool StressTest::run(uint32_t step, std::ostream& stream)
+{
+    const auto spawned = populate();
+
+    if (spawned == 0) {
+        LOG_ERROR << "Failed to spawn any enemy for the stress test" << std::endl;
+        return false;
+    }
+
+    std::vector<double> frame_times;
+    std::vector<double> update_times;
+    std::vector<double> render_times;
+    std::vector<double> present_times;
+
+    frame_times.reserve(m_frames);
+    update_times.reserve(m_frames);
+    render_times.reserve(m_frames);
+    present_times.reserve(m_frames);
+
+    for (int frame = 0; frame < m_frames; ++frame) {
+        const auto start = Clock::now();
+
+        // The player only stands there to be attacked.
+        m_player.set_health(m_player.max_health());
+
+        drive(frame);
+
+        const auto update_start = Clock::now();
+
+        m_game.map.update(step);
+
+        const auto update_end = Clock::now();
+
+        m_game.emitter.update(step);
+        m_game.combat.resolve();
+        m_game.combat_text.update(step);
+
+        const auto render_start = Clock::now();
+
+        SDL_RenderClear(m_game.window.renderer());
+        m_game.map.render();
+
+        const auto end = Clock::now();
+
+        // The renderer waits for the display here (vsync), which is timed on its own.
+        SDL_RenderPresent(m_game.window.renderer());
+
+        frame_times.push_back(milliseconds(start, end));
+        update_times.push_back(milliseconds(update_start, update_end));
+        render_times.push_back(milliseconds(render_start, end));
+        present_times.push_back(milliseconds(end, Clock::now()));
+    }
+
+    int alive = 0;
+
+    for (auto handle : m_handles) {
+        if (auto entity = m_game.map.entity(handle); entity != nullptr && !entity->dead()) {
+            ++alive;
+        }
+    }
+
+    const auto& simulation = m_game.map.simulation_stats();
+    const auto& render     = m_game.map.render_stats();
+
+    rapidjson::OStreamWrapper osw(stream);
+    Writer                    writer(osw);
+
+    writer.StartObject();
+    writer.Key("enemies");
+    writer.Int(spawned);
+    writer.Key("alive");
+    writer.Int(alive);
+    writer.Key("frames");
+    writer.Int(m_frames);
+    writer.Key("step_ms");
+    writer.Uint(step);
+
+    write_distribution(writer, "frame_ms", frame_times);
+    write_distribution(writer, "update_ms", update_times);
+    write_distribution(writer, "render_ms", render_times);
+    write_distribution(writer, "present_ms", present_times);
+
+    writer.Key("last_frame");
+    writer.StartObject();
+    writer.Key("full_detail");
+    writer.Int(simulation.full_detail);
+    writer.Key("reduced_detail");
+    writer.Int(simulation.reduced_detail);
+    writer.Key("dormant");
+    writer.Int(simulation.dormant);
+    writer.Key("updated");
+    writer.Int(simulation.updated);
+    writer.Key("drawn_entities");
+    writer.Int(render.drawn_entities);
+    writer.Key("culled_entities");
+    writer.Int(render.culled_entities);
+    writer.EndObject();
+
+    writer.EndObject();
+
+    stream << std::endl;
+
+    return writer.IsComplete() && stream.good();
+}
+
+int StressTest::populate()
+{
+    std::vector<int> archetypes;
+
+    for (int id = 0; id <= Archetypes::MAX_ID; ++id) {
+        // Every archetype but the player's own (whatever the player happens to be on this level).
+        if (m_game.archetypes.find(id) != nullptr && id != Archetypes::PLAYER_ID) {
+            archetypes.push_back(id);
+        }
+    }
+
+    if (archetypes.empty()) {
+        LOG_ERROR << "No enemy archetype to spawn" << std::endl;
+        return 0;
+    }
+
+    const auto& collision = m_game.map.search_graph().agent_collision();
+
+    m_handles.clear();
+    m_handles.reserve(m_enemies);
+
+    for (int i = 0; i < m_enemies; ++i) {
+        int x = 0;
+        int y = 0;
+
+        // Anywhere on the map.
+        if (!random_position(MAP_TILE_ROW_COUNT / 2, MAP_TILE_COL_COUNT / 2, MAP_TILE_COL_COUNT, x, y)) {
+            continue;
+        }
+
+        const auto handle = m_game.map.spawn(Entity::ENEMY_TYPE, archetypes[i % archetypes.size()],
+                                             x - CHARACTER_WIDTH / 2, y - CHARACTER_HEIGHT / 2);
+
+        if (auto entity = m_game.map.entity(handle); entity != nullptr) {
+            // The tile under the bounding box is not quite the tile under the center.
+            if (const auto cell = entity->cell(); collision.blocked(cell.row, cell.column)) {
+                m_game.map.despawn(handle);
+                continue;
+            }
+
+            m_handles.push_back(handle);
+        }
+    }
+
+    LOG_DEBUG << "Stress test enemies: " << m_handles.size() << "/" << m_enemies << std::endl;
+
+    return m_handles.size();
+}
+
+void StressTest::drive(int frame)
+{
+    // A slice of the enemies every frame so that the orders are spread out evenly.
+    for (size_t i = frame % ORDER_INTERVAL; i < m_handles.size(); i += ORDER_INTERVAL) {
+        auto entity = m_game.map.entity(m_handles[i]);
+
+        if (entity == nullptr || entity->dead() || entity->attacking()) {
+            continue;
+        }
+
+        if (m_rng() % ATTACK_RATIO == 0) {
+            if (entity->is_near_entity(&m_player)) {
+                entity->attack(&m_player);
+            } else if (auto target = entity->find_target(entity->archetype().attack_short_range); target != nullptr) {
+                entity->attack(target);
+            }
+
+            continue;
+        }
+
+        const auto cell = entity->cell();
+
+        if (int x = 0, y = 0; random_position(cell.row, cell.column, WALK_RADIUS, x, y)) {
+            entity->walk_to_position(x, y);
+        }
+    }
+}
+
+bool StressTest::random_position(int row, int column, int radius, int& x, int& y)
+{
+    const auto& collision = m_game.map.search_graph().agent_collision();
+
+    for (int i = 0; i < PLACEMENT_TRIES; ++i) {
+        const auto r = std::clamp(row + static_cast<int>(m_rng() % (radius * 2 + 1)) - radius, 0,
+                                  MAP_TILE_ROW_COUNT - 1);
+        const auto c = std::clamp(column + static_cast<int>(m_rng() % (radius * 2 + 1)) - radius, 0,
+                                  MAP_TILE_COL_COUNT - 1);
+
+        if (!collision.blocked(r, c)) {
+            x = c * MAP_TILE_SIZE + MAP_TILE_SIZE / 2;
+            y = r * MAP_TILE_SIZE + MAP_TILE_SIZE / 2;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <vector>
+
+#include "characters/entity.h"
+
+class Game;
+
+// StressTest fills the current level with thousands of enemies (of every archetype but the
+// player archetype) and runs the game for a fixed number of frames. The enemies are placed on random free
+// tiles, walk to random tiles nearby and attack whoever is within reach every now and then, on top
+// of what the AI makes them do.
+//
+// Every frame is simulated over the same step and the enemies only depend on the seed, but the
+// AI, the levels of detail and the animations follow the wall clock, so two runs are not the same.
+// The frame times (with the time spent updating and rendering, but not presenting, which waits for
+// the display) are written as a single JSON document along with the time spent presenting.
+class StressTest
+{
+public:
+    // The default seed of the enemies.
+    static const uint32_t DEFAULT_SEED = 1;
+
+    // The default number of enemies.
+    static const int DEFAULT_ENEMIES = 1000;
+
+    // The default number of frames.
+    static const int DEFAULT_FRAMES = 600;
+
+public:
+    // Create a new stress test for the game (the player is kept alive for the whole run).
+    explicit StressTest(Game& game, Entity& player, int enemies = DEFAULT_ENEMIES, int frames = DEFAULT_FRAMES,
+                        uint32_t seed = DEFAULT_SEED);
+
+public:
+    // Spawn the enemies, run every frame over the given step (in milliseconds) and write the results
+    // as JSON. Returns false if the enemies could not be spawned or writing failed.
+    bool run(uint32_t step, std::ostream& stream);
+
+private:
+    // Spawn the enemies on random free tiles. Returns the number of enemies spawned.
+    int populate();
+
+    // Give new orders to the enemies whose turn it is.
+    void drive(int frame);
+
+    // Return the position (in pixels) of the center of a random free tile within a radius (in tiles)
+    // of a tile.
+    bool random_position(int row, int column, int radius, int& x, int& y);
+
+private:
+    Game&   m_game;
+    Entity& m_player;
+
+    int m_enemies;
+    int m_frames;
+
+    std::mt19937        m_rng;
+    std::vector<Handle> m_handles;
+};
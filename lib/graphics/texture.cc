@@ -90,6 +90,30 @@ bool Texture::load_from_text(SDL_Renderer* renderer, const char* text, TTF_Font*
     return true;
 }
 
+bool Texture::load_from_surface(SDL_Renderer* renderer, SDL_Surface* surface)
+{
+    cleanup();
+
+    if (m_renderer != renderer) {
+        m_renderer = renderer;
+    }
+
+    m_texture = SDL_CreateTextureFromSurface(m_renderer, surface);
+
+    if (m_texture == nullptr) {
+        LOG_ERROR << "Failed to create texture from surface: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    m_width  = surface->w;
+    m_height = surface->h;
+
+    m_dest.w = m_width;
+    m_dest.h = m_height;
+
+    return true;
+}
+
 void Texture::cleanup()
 {
     LOG_DEBUG << "Texture destroyed..."
@@ -172,6 +196,11 @@ void Texture::render_transform(int x, int y)
     SDL_RenderCopyEx(m_renderer, m_texture, nullptr, &m_dest, m_rotation, nullptr, SDL_FLIP_NONE);
 }
 
+void Texture::render_transform(const SDL_Rect* src, const SDL_Rect& dest, float rotation, const SDL_Point* center)
+{
+    SDL_RenderCopyEx(m_renderer, m_texture, src, &dest, rotation, center, SDL_FLIP_NONE);
+}
+
 void Texture::render_color(int x, int y, const SDL_Color color, const SDL_Rect* src)
 {
     m_dest.x = x;
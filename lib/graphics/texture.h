@@ -29,6 +29,9 @@ public:
     // the size of the rendered text.
     bool load_from_text(SDL_Renderer* renderer, const char* text, TTF_Font* font, const SDL_Color& color);
 
+    // Load from a surface built by the caller (who still owns it).
+    bool load_from_surface(SDL_Renderer* renderer, SDL_Surface* surface);
+
     // Cleanup/reset the texture.
     void cleanup();
 
@@ -38,6 +41,10 @@ public:
     // Transform and then render texture.
     void render_transform(int x, int y);
 
+    // Render a clip of the texture stretched to dest and rotated (in degrees) around a point
+    // relative to dest (its center if nullptr).
+    void render_transform(const SDL_Rect* src, const SDL_Rect& dest, float rotation, const SDL_Point* center);
+
     // Render the texture using color modulation.
     void render_color(int x, int y, const SDL_Color color, const SDL_Rect* src = nullptr);
 
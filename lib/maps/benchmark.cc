@@ -0,0 +1,511 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "maps/benchmark.h"
+
+#include <rapidjson/ostreamwrapper.h>
+#include <rapidjson/writer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "maps/cache.h"
+#include "maps/flow.h"
+#include "maps/planner.h"
+#include "maps/search.h"
+
+using Writer = rapidjson::Writer<rapidjson::OStreamWrapper>;
+using Cell   = SearchGraph::Cell;
+using Query  = std::pair<Cell, Cell>;
+
+// The grid sizes (width and height in tiles).
+static const int GRID_SIZES[] = { 100, 256, 512, 1024, 2048 };
+
+// The grids generated at every size.
+static const struct
+{
+    const char*             name;
+    SearchBenchmark::Layout layout;
+    int                     density;
+} GRID_LAYOUTS[] = {
+    { "open", SearchBenchmark::OPEN, 0 },     { "random", SearchBenchmark::RANDOM, 10 },
+    { "random", SearchBenchmark::RANDOM, 20 }, { "random", SearchBenchmark::RANDOM, 30 },
+    { "maze", SearchBenchmark::MAZE, 0 },     { "rooms", SearchBenchmark::ROOMS, 0 },
+};
+
+// Each cached query is repeated from and to nearby tiles this many times.
+static const int CACHE_REPEATS = 4;
+
+// How far (in tiles) the repeated cache queries are moved.
+static const int CACHE_JITTER = 3;
+
+// The planner follows a moving destination for this many steps on the first few queries.
+static const int PLANNER_CHASES = 4;
+static const int PLANNER_STEPS  = 16;
+
+// The rooms of the ROOMS layout (one room per this many tiles).
+static const int ROOM_AREA     = 600;
+static const int ROOM_MIN_SIZE = 4;
+static const int ROOM_MAX_SIZE = 16;
+
+// The neighbors of a cell.
+static const int NEIGHBOR_OFFSETS[8][2] = {
+    { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 }, { -1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 },
+};
+
+// A single measured query.
+struct Sample
+{
+    double latency;
+    int    nodes_expanded;
+    size_t path_length;
+    bool   found;
+};
+
+// Return the microseconds since a point in time.
+static double elapsed_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Return a random number in [0, bound). The raw engine output is used (rather than a distribution)
+// so that the grids are the same with every standard library.
+static int random_below(std::mt19937& rng, int bound)
+{
+    return rng() % bound;
+}
+
+// Return a random free cell near a cell (or the cell itself if none is found).
+static Cell random_free_cell(const CollisionGrid& grid, std::mt19937& rng, Cell center, int radius)
+{
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        const Cell cell = { center.row + random_below(rng, 2 * radius + 1) - radius,
+                            center.column + random_below(rng, 2 * radius + 1) - radius };
+
+        if (!grid.blocked(cell.row, cell.column)) {
+            return cell;
+        }
+    }
+
+    return center;
+}
+
+// Pick the queries between random free cells.
+static std::vector<Query> make_queries(const CollisionGrid& grid, uint32_t seed, int count)
+{
+    std::mt19937 rng(seed);
+
+    const auto radius = std::max(grid.rows(), grid.columns());
+    const Cell center = { grid.rows() / 2, grid.columns() / 2 };
+
+    std::vector<Query> queries;
+
+    for (int i = 0; i < count; ++i) {
+        queries.push_back({ random_free_cell(grid, rng, center, radius), random_free_cell(grid, rng, center, radius) });
+    }
+
+    return queries;
+}
+
+// Write the summary of a set of samples.
+static void write_samples(Writer& writer, const char* algorithm, std::vector<Sample>& samples, size_t memory)
+{
+    std::sort(samples.begin(), samples.end(),
+              [](const Sample& a, const Sample& b) { return a.latency < b.latency; });
+
+    auto   found          = 0;
+    auto   max_expanded   = 0;
+    double total_latency  = 0.0;
+    double total_expanded = 0.0;
+    double total_length   = 0.0;
+
+    for (const auto& sample : samples) {
+        total_latency += sample.latency;
+        total_expanded += sample.nodes_expanded;
+        max_expanded = std::max(max_expanded, sample.nodes_expanded);
+
+        if (sample.found) {
+            total_length += sample.path_length;
+            ++found;
+        }
+    }
+
+    const auto count      = std::max<size_t>(samples.size(), 1);
+    const auto percentile = [&samples](size_t percent) {
+        return samples.empty() ? 0.0 : samples[(samples.size() - 1) * percent / 100].latency;
+    };
+
+    writer.StartObject();
+    writer.Key("algorithm");
+    writer.String(algorithm);
+    writer.Key("queries");
+    writer.Uint(samples.size());
+    writer.Key("found");
+    writer.Int(found);
+
+    writer.Key("latency_us");
+    writer.StartObject();
+    writer.Key("mean");
+    writer.Double(total_latency / count);
+    writer.Key("p50");
+    writer.Double(percentile(50));
+    writer.Key("p95");
+    writer.Double(percentile(95));
+    writer.Key("max");
+    writer.Double(percentile(100));
+    writer.EndObject();
+
+    writer.Key("nodes_expanded");
+    writer.StartObject();
+    writer.Key("mean");
+    writer.Double(total_expanded / count);
+    writer.Key("max");
+    writer.Int(max_expanded);
+    writer.EndObject();
+
+    writer.Key("path_length_mean");
+    writer.Double(found > 0 ? total_length / found : 0.0);
+    writer.Key("memory_bytes");
+    writer.Uint64(memory);
+    writer.EndObject();
+}
+
+// Measure the queries with every algorithm of the search graph.
+static void benchmark_searches(Writer& writer, SearchGraph& graph, const std::vector<Query>& queries)
+{
+    static const std::pair<const char*, SearchGraph::Algorithm> ALGORITHMS[] = {
+        { "a_star", SearchGraph::A_STAR },
+        { "jump_point", SearchGraph::JUMP_POINT },
+        { "hierarchical", SearchGraph::HIERARCHICAL },
+    };
+
+    std::vector<Cell> path;
+
+    for (const auto& [name, algorithm] : ALGORITHMS) {
+        std::vector<Sample> samples;
+
+        for (const auto& [src, dest] : queries) {
+            const auto start = std::chrono::steady_clock::now();
+            const auto found = graph.find_path(src, dest, path, algorithm);
+
+            samples.push_back({ elapsed_since(start), graph.nodes_expanded(), path.size(), found });
+        }
+
+        write_samples(writer, name, samples, graph.memory_usage(algorithm));
+    }
+}
+
+// Measure the path cache with queries repeated from and to nearby tiles (the first of each is a miss).
+static void benchmark_cache(Writer& writer, SearchGraph& graph, const std::vector<Query>& queries, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+
+    PathCache         cache(graph.collision().rows(), graph.collision().columns());
+    std::vector<Cell> path;
+
+    std::vector<Sample> samples;
+
+    for (const auto& query : queries) {
+        for (int i = 0; i < CACHE_REPEATS; ++i) {
+            auto [src, dest] = query;
+
+            if (i > 0) {
+                src  = random_free_cell(graph.agent_collision(), rng, src, CACHE_JITTER);
+                dest = random_free_cell(graph.agent_collision(), rng, dest, CACHE_JITTER);
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+
+            auto found    = cache.find(graph, src, dest, path);
+            auto expanded = cache.nodes_expanded();
+
+            if (!found) {
+                found = graph.find_path(src, dest, path, SearchGraph::JUMP_POINT);
+                expanded += graph.nodes_expanded();
+
+                if (found) {
+                    cache.insert(src, dest, path);
+                }
+            }
+
+            samples.push_back({ elapsed_since(start), expanded, path.size(), found });
+        }
+    }
+
+    write_samples(writer, "path_cache", samples, cache.memory_usage());
+}
+
+// Measure a flow field rooted at the source of every query.
+static void benchmark_flow_field(Writer& writer, const SearchGraph& graph, const std::vector<Query>& queries)
+{
+    FlowField flow(graph.agent_collision(), std::numeric_limits<uint32_t>::max());
+
+    std::vector<Sample> samples;
+
+    for (const auto& [src, dest] : queries) {
+        const auto start = std::chrono::steady_clock::now();
+
+        flow.invalidate();
+        flow.update(src);
+
+        const auto latency = elapsed_since(start);
+        const auto found   = flow.distance(dest) != FlowField::UNREACHABLE;
+
+        // Following the field from the destination gives the path length.
+        size_t length = 0;
+
+        for (auto cell = dest; found && !(cell == src); cell = flow.next(cell)) {
+            ++length;
+        }
+
+        samples.push_back({ latency, flow.size(), length, found });
+    }
+
+    write_samples(writer, "flow_field", samples, flow.memory_usage());
+}
+
+// Measure the incremental planner (and A* from scratch for comparison) following a destination that
+// moves one tile per step, with the source catching up and walls changing every few steps.
+// Changes the graph.
+static void benchmark_planner(Writer& writer, SearchGraph& graph, const std::vector<Query>& queries, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+
+    Planner           planner(graph.collision());
+    std::vector<Cell> path;
+    std::vector<Cell> scratch;
+
+    std::vector<Sample> incremental;
+    std::vector<Sample> from_scratch;
+
+    const auto& grid = graph.collision();
+
+    for (int chase = 0; chase < PLANNER_CHASES && chase < static_cast<int>(queries.size()); ++chase) {
+        auto [src, dest] = queries[chase];
+
+        planner.reset();
+
+        for (int step = 0; step < PLANNER_STEPS; ++step) {
+            if (step > 0) {
+                const auto& [dr, dc] = NEIGHBOR_OFFSETS[random_below(rng, 8)];
+
+                if (!grid.blocked(dest.row + dr, dest.column + dc)) {
+                    dest = { dest.row + dr, dest.column + dc };
+                }
+
+                if (step % 4 == 0 && !path.empty()) {
+                    src = path.front();
+                }
+
+                if (step % 8 == 0) {
+                    const Cell cell = { random_below(rng, grid.rows()), random_below(rng, grid.columns()) };
+
+                    if (!(cell == src) && !(cell == dest)) {
+                        graph.set_blocked(cell, !graph.blocked(cell));
+                        planner.update(cell);
+                    }
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            auto found = planner.find_path(src, dest, path);
+
+            incremental.push_back({ elapsed_since(start), planner.nodes_expanded(), path.size(), found });
+
+            start = std::chrono::steady_clock::now();
+            found = graph.find_path(src, dest, scratch, SearchGraph::A_STAR);
+
+            from_scratch.push_back({ elapsed_since(start), graph.nodes_expanded(), scratch.size(), found });
+        }
+    }
+
+    write_samples(writer, "planner", incremental, planner.memory_usage());
+    write_samples(writer, "planner_a_star", from_scratch, graph.memory_usage(SearchGraph::A_STAR));
+}
+
+SearchBenchmark::SearchBenchmark(uint32_t seed, int query_count, int max_size)
+  : m_seed(seed)
+  , m_query_count(query_count)
+  , m_max_size(max_size)
+{
+}
+
+bool SearchBenchmark::run(std::ostream& stream) const
+{
+    rapidjson::OStreamWrapper osw(stream);
+    Writer                    writer(osw);
+
+    writer.StartObject();
+    writer.Key("seed");
+    writer.Uint(m_seed);
+    writer.Key("queries");
+    writer.Int(m_query_count);
+    writer.Key("grids");
+    writer.StartArray();
+
+    for (const auto size : GRID_SIZES) {
+        if (size > m_max_size) {
+            break;
+        }
+
+        for (const auto& [name, layout, density] : GRID_LAYOUTS) {
+            // Every grid gets its own seed, so adding grids does not change the others.
+            const auto seed = m_seed ^ (size * 7919u) ^ (layout * 104729u) ^ (density * 1299709u);
+
+            CollisionGrid grid(size, size);
+
+            generate(grid, layout, density, seed);
+
+            SearchGraph graph(size, size);
+
+            const auto start = std::chrono::steady_clock::now();
+
+            // The whole grid is copied at once, which also builds the clearance map and the hierarchy.
+            graph.assign(grid);
+
+            const auto build_time = elapsed_since(start);
+            const auto queries    = make_queries(grid, seed, m_query_count);
+
+            auto blocked = 0;
+
+            for (int row = 0; row < size; ++row) {
+                for (int col = 0; col < size; ++col) {
+                    blocked += grid.blocked(row, col);
+                }
+            }
+
+            writer.StartObject();
+            writer.Key("layout");
+            writer.String(name);
+            writer.Key("density");
+            writer.Int(density);
+            writer.Key("size");
+            writer.Int(size);
+            writer.Key("blocked");
+            writer.Int(blocked);
+            writer.Key("build_us");
+            writer.Double(build_time);
+            writer.Key("algorithms");
+            writer.StartArray();
+
+            benchmark_searches(writer, graph, queries);
+            benchmark_cache(writer, graph, queries, seed);
+            benchmark_flow_field(writer, graph, queries);
+
+            // Last, since it changes the grid.
+            benchmark_planner(writer, graph, queries, seed);
+
+            writer.EndArray();
+            writer.EndObject();
+
+            stream.flush();
+        }
+    }
+
+    writer.EndArray();
+    writer.EndObject();
+
+    stream << std::endl;
+
+    return writer.IsComplete() && stream.good();
+}
+
+void SearchBenchmark::generate(CollisionGrid& grid, Layout layout, int density, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+
+    const auto rows    = grid.rows();
+    const auto columns = grid.columns();
+
+    for (int row = 0; row < rows; ++row) {
+        for (int col = 0; col < columns; ++col) {
+            grid.set_blocked(row, col, layout == MAZE || layout == ROOMS);
+        }
+    }
+
+    switch (layout) {
+    case OPEN:
+        break;
+    case RANDOM:
+        for (int row = 0; row < rows; ++row) {
+            for (int col = 0; col < columns; ++col) {
+                grid.set_blocked(row, col, random_below(rng, 100) < density);
+            }
+        }
+        break;
+    case MAZE: {
+        // Carve the passages between the odd cells with a randomized depth-first search.
+        std::vector<Cell> stack = { { 1, 1 } };
+
+        grid.set_blocked(1, 1, false);
+
+        while (!stack.empty()) {
+            const auto cell = stack.back();
+
+            Cell candidates[4];
+            int  count = 0;
+
+            for (int i = 0; i < 4; ++i) {
+                const Cell next = { cell.row + NEIGHBOR_OFFSETS[i][0] * 2, cell.column + NEIGHBOR_OFFSETS[i][1] * 2 };
+
+                if (next.row > 0 && next.column > 0 && next.row < rows - 1 && next.column < columns - 1
+                    && grid.blocked(next.row, next.column)) {
+                    candidates[count++] = next;
+                }
+            }
+
+            if (count == 0) {
+                stack.pop_back();
+                continue;
+            }
+
+            const auto next = candidates[random_below(rng, count)];
+
+            grid.set_blocked((cell.row + next.row) / 2, (cell.column + next.column) / 2, false);
+            grid.set_blocked(next.row, next.column, false);
+
+            stack.push_back(next);
+        }
+        break;
+    }
+    case ROOMS: {
+        // Carve rooms and join each one to the previous with an L-shaped corridor.
+        Cell previous = { -1, -1 };
+
+        for (int room = 0; room < std::max(2, rows * columns / ROOM_AREA); ++room) {
+            const auto height = ROOM_MIN_SIZE + random_below(rng, ROOM_MAX_SIZE - ROOM_MIN_SIZE + 1);
+            const auto width  = ROOM_MIN_SIZE + random_below(rng, ROOM_MAX_SIZE - ROOM_MIN_SIZE + 1);
+            const auto top    = 1 + random_below(rng, std::max(1, rows - height - 2));
+            const auto left   = 1 + random_below(rng, std::max(1, columns - width - 2));
+
+            for (int row = top; row < std::min(top + height, rows - 1); ++row) {
+                for (int col = left; col < std::min(left + width, columns - 1); ++col) {
+                    grid.set_blocked(row, col, false);
+                }
+            }
+
+            const Cell center = { std::min(top + height / 2, rows - 2), std::min(left + width / 2, columns - 2) };
+
+            if (previous.row >= 0) {
+                for (int col = std::min(previous.column, center.column); col <= std::max(previous.column, center.column);
+                     ++col) {
+                    grid.set_blocked(previous.row, col, false);
+                }
+
+                for (int row = std::min(previous.row, center.row); row <= std::max(previous.row, center.row); ++row) {
+                    grid.set_blocked(row, center.column, false);
+                }
+            }
+
+            previous = center;
+        }
+        break;
+    }
+    }
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+#include "maps/collision.h"
+
+// SearchBenchmark measures the path searches of the engine on generated grids (an open field,
+// random obstacles at several densities, a maze and rooms joined by corridors) from 100x100 up
+// to 2048x2048 tiles. Every algorithm answers the same queries and reports its latency, nodes
+// expanded and memory, so the algorithms can be chosen per kind of level.
+//
+// Grids and queries only depend on the seed, so results can be tracked from run to run. The
+// results are written as a single JSON document.
+class SearchBenchmark
+{
+public:
+    // The layout of a generated grid.
+    enum Layout
+    {
+        OPEN,
+        RANDOM,
+        MAZE,
+        ROOMS,
+    };
+
+    // The default seed of the grids and queries.
+    static const uint32_t DEFAULT_SEED = 1;
+
+    // The default number of queries per grid.
+    static const int DEFAULT_QUERY_COUNT = 32;
+
+    // The default size of the largest grid.
+    static const int DEFAULT_MAX_SIZE = 2048;
+
+public:
+    // Create a new benchmark.
+    explicit SearchBenchmark(uint32_t seed = DEFAULT_SEED, int query_count = DEFAULT_QUERY_COUNT,
+                             int max_size = DEFAULT_MAX_SIZE);
+
+public:
+    // Run every benchmark and write the results as JSON. Returns false if writing failed.
+    bool run(std::ostream& stream) const;
+
+    // Fill a grid with a layout (density is the percentage of blocked tiles for RANDOM).
+    static void generate(CollisionGrid& grid, Layout layout, int density, uint32_t seed);
+
+private:
+    uint32_t m_seed;
+    int      m_query_count;
+    int      m_max_size;
+};
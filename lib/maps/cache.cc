@@ -0,0 +1,276 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "maps/cache.h"
+
+#include <algorithm>
+
+// Tile lists are cleaned of replaced entries once they grow past this size.
+static const size_t TILE_LIST_COMPACT_SIZE = 16;
+
+PathCache::PathCache(int rows, int columns, int region_size, int capacity)
+  : m_rows(rows)
+  , m_columns(columns)
+  , m_region_size(region_size)
+  , m_region_columns((columns + region_size - 1) / region_size)
+  , m_entries(capacity)
+  , m_next_slot(0)
+  , m_tiles(rows * columns)
+  , m_positions(rows * columns, -1)
+  , m_stats()
+  , m_nodes_expanded(0)
+{
+    for (auto& entry : m_entries) {
+        entry.generation = 0;
+        entry.used       = false;
+    }
+}
+
+bool PathCache::find(SearchGraph& graph, Cell src, Cell dest, std::vector<Cell>& path)
+{
+    path.clear();
+
+    m_nodes_expanded = 0;
+
+    const auto slot = m_slots.find(key_of(src, dest));
+
+    if (slot == m_slots.end()) {
+        ++m_stats.misses;
+        return false;
+    }
+
+    // The cached path starts with its own source.
+    const auto& cached = m_entries[slot->second].path;
+
+    m_piece.clear();
+    m_piece.push_back(src);
+
+    if (!join(graph, src, cached.front(), m_piece)) {
+        ++m_stats.misses;
+        return false;
+    }
+
+    m_piece.insert(m_piece.end(), cached.begin() + 1, cached.end());
+
+    if (!join(graph, cached.back(), dest, m_piece)) {
+        ++m_stats.misses;
+        return false;
+    }
+
+    // Joining the pieces can walk back over the cached path (ex. when the source is further
+    // along it), so cut out the loops.
+    for (const auto& cell : m_piece) {
+        const auto index    = cell.row * m_columns + cell.column;
+        const auto position = m_positions[index];
+
+        if (position >= 0 && position < static_cast<int>(path.size()) && path[position] == cell) {
+            path.resize(position + 1);
+        } else {
+            m_positions[index] = path.size();
+            path.push_back(cell);
+        }
+    }
+
+    for (const auto& cell : m_piece) {
+        m_positions[cell.row * m_columns + cell.column] = -1;
+    }
+
+    // The source is not part of the path.
+    path.erase(path.begin());
+
+    ++m_stats.hits;
+
+    return true;
+}
+
+void PathCache::insert(Cell src, Cell dest, const std::vector<Cell>& path)
+{
+    if (m_entries.empty()) {
+        return;
+    }
+
+    const auto key = key_of(src, dest);
+
+    // Replace the entry for the same regions or else the oldest one.
+    auto slot = m_next_slot;
+
+    if (const auto iter = m_slots.find(key); iter != m_slots.end()) {
+        slot = iter->second;
+    } else {
+        m_next_slot = (m_next_slot + 1) % m_entries.size();
+    }
+
+    erase(slot);
+
+    auto& entry = m_entries[slot];
+
+    entry.key  = key;
+    entry.used = true;
+    entry.path.clear();
+    entry.path.push_back(src);
+    entry.path.insert(entry.path.end(), path.begin(), path.end());
+
+    m_slots[key] = slot;
+
+    for (size_t i = 0; i < entry.path.size(); ++i) {
+        const auto& cell = entry.path[i];
+
+        add_reference(cell, slot);
+
+        // Diagonal steps also depend on the two tiles beside them.
+        if (i > 0 && cell.row != entry.path[i - 1].row && cell.column != entry.path[i - 1].column) {
+            add_reference({ entry.path[i - 1].row, cell.column }, slot);
+            add_reference({ cell.row, entry.path[i - 1].column }, slot);
+        }
+    }
+
+    ++m_stats.entries;
+}
+
+void PathCache::add_reference(Cell cell, int slot)
+{
+    auto& entries = m_tiles[cell.row * m_columns + cell.column];
+
+    if (entries.size() >= TILE_LIST_COMPACT_SIZE) {
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [this](const std::pair<int, uint32_t>& ref) {
+                                         return m_entries[ref.first].generation != ref.second;
+                                     }),
+                      entries.end());
+    }
+
+    entries.push_back({ slot, m_entries[slot].generation });
+}
+
+void PathCache::invalidate(Cell cell)
+{
+    if (cell.row < 0 || cell.column < 0 || cell.row >= m_rows || cell.column >= m_columns) {
+        return;
+    }
+
+    auto& entries = m_tiles[cell.row * m_columns + cell.column];
+
+    for (const auto& [slot, generation] : entries) {
+        if (m_entries[slot].generation == generation && m_entries[slot].used) {
+            erase(slot);
+            ++m_stats.invalidations;
+        }
+    }
+
+    entries.clear();
+}
+
+void PathCache::clear()
+{
+    for (size_t slot = 0; slot < m_entries.size(); ++slot) {
+        erase(slot);
+    }
+
+    for (auto& entries : m_tiles) {
+        entries.clear();
+    }
+
+    m_next_slot = 0;
+}
+
+void PathCache::set_region_size(int region_size)
+{
+    clear();
+
+    m_region_size    = region_size;
+    m_region_columns = (m_columns + region_size - 1) / region_size;
+    m_stats          = Stats();
+}
+
+int PathCache::nodes_expanded() const
+{
+    return m_nodes_expanded;
+}
+
+size_t PathCache::memory_usage() const
+{
+    auto bytes = m_entries.capacity() * sizeof(Entry) + m_tiles.capacity() * sizeof(m_tiles[0]);
+
+    for (const auto& entry : m_entries) {
+        bytes += entry.path.capacity() * sizeof(Cell);
+    }
+
+    for (const auto& entries : m_tiles) {
+        bytes += entries.capacity() * sizeof(entries[0]);
+    }
+
+    // Roughly one node (key, slot and the next pointer) and one bucket per slot.
+    bytes += m_slots.size() * (sizeof(uint64_t) + sizeof(int) + sizeof(void*)) + m_slots.bucket_count() * sizeof(void*);
+    bytes += (m_piece.capacity() + m_join.capacity()) * sizeof(Cell) + m_positions.capacity() * sizeof(int);
+
+    return bytes;
+}
+
+int PathCache::region_size() const
+{
+    return m_region_size;
+}
+
+const PathCache::Stats& PathCache::stats() const
+{
+    return m_stats;
+}
+
+double PathCache::hit_rate() const
+{
+    const auto lookups = m_stats.hits + m_stats.misses;
+
+    return lookups > 0 ? static_cast<double>(m_stats.hits) / lookups : 0.0;
+}
+
+uint64_t PathCache::key_of(Cell src, Cell dest) const
+{
+    const uint64_t src_region  = (src.row / m_region_size) * m_region_columns + (src.column / m_region_size);
+    const uint64_t dest_region = (dest.row / m_region_size) * m_region_columns + (dest.column / m_region_size);
+
+    return (src_region << 32) | dest_region;
+}
+
+void PathCache::erase(int slot)
+{
+    auto& entry = m_entries[slot];
+
+    if (!entry.used) {
+        return;
+    }
+
+    m_slots.erase(entry.key);
+
+    // References to the entry from the tiles are stale from now on.
+    ++entry.generation;
+
+    entry.used = false;
+    entry.path.clear();
+
+    --m_stats.entries;
+}
+
+bool PathCache::join(SearchGraph& graph, Cell src, Cell dest, std::vector<Cell>& path)
+{
+    if (src == dest) {
+        return true;
+    }
+
+    graph.start_search(src, dest);
+
+    const auto status = graph.continue_search(JOIN_BUDGET);
+
+    m_nodes_expanded += graph.nodes_expanded();
+
+    if (status != SearchGraph::FOUND) {
+        return false;
+    }
+
+    graph.search_path(m_join);
+
+    path.insert(path.end(), m_join.begin(), m_join.end());
+
+    return true;
+}
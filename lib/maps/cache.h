@@ -0,0 +1,125 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "maps/search.h"
+
+// PathCache remembers found paths by the regions (square blocks of tiles) of their source and
+// destination. A request between the same regions reuses the stored path and only searches
+// for the short pieces joining its exact source and destination to the ends of the stored path.
+//
+// Every tile keeps a list of the entries whose path crosses it (or cuts past its corner), so
+// when a tile becomes blocked only those entries are dropped. Tiles that open up do not invalidate anything (stored paths
+// remain walkable, if not always the shortest).
+class PathCache
+{
+public:
+    using Cell = SearchGraph::Cell;
+
+    // Counters since the cache was created (or the region size was changed).
+    struct Stats
+    {
+        int hits;
+        int misses;
+        int invalidations;
+        int entries;
+    };
+
+    // The default width and height of a region (in tiles).
+    static const int DEFAULT_REGION_SIZE = 8;
+
+    // The default maximum number of entries.
+    static const int DEFAULT_CAPACITY = 256;
+
+public:
+    // Create a new empty cache for a grid of the given size.
+    explicit PathCache(int rows, int columns, int region_size = DEFAULT_REGION_SIZE,
+                       int capacity = DEFAULT_CAPACITY);
+
+public:
+    // Find a path between the regions of source and destination and join it to the exact cells
+    // using the search graph. The path is in the same format as SearchGraph::find_path(). Returns
+    // false on a miss (or if the cached path cannot be joined).
+    bool find(SearchGraph& graph, Cell src, Cell dest, std::vector<Cell>& path);
+
+    // Store a path found from source to destination.
+    void insert(Cell src, Cell dest, const std::vector<Cell>& path);
+
+    // Drop the entries whose path crosses (or cuts past the corner of) a tile (ex. the tile became blocked).
+    void invalidate(Cell cell);
+
+    // Drop every entry.
+    void clear();
+
+    // Set the size of the regions (drops every entry and resets the counters).
+    void set_region_size(int region_size);
+
+    // Return the size of the regions.
+    int region_size() const;
+
+    // Return the counters.
+    const Stats& stats() const;
+
+    // Return the ratio of lookups that were hits.
+    double hit_rate() const;
+
+    // Return the number of nodes expanded joining paths by the last find().
+    int nodes_expanded() const;
+
+    // Return the number of bytes allocated by the cache.
+    size_t memory_usage() const;
+
+private:
+    struct Entry
+    {
+        uint64_t          key;
+        uint32_t          generation;
+        bool              used;
+        std::vector<Cell> path;
+    };
+
+    // The most nodes expanded while joining the cached path to the exact cells.
+    static const int JOIN_BUDGET = 256;
+
+    // Return the key of a pair of cells.
+    uint64_t key_of(Cell src, Cell dest) const;
+
+    // Remove an entry.
+    void erase(int slot);
+
+    // Add an entry to the list of a tile its path depends on.
+    void add_reference(Cell cell, int slot);
+
+    // Append the path between two cells. Returns false if it was not found within the budget.
+    bool join(SearchGraph& graph, Cell src, Cell dest, std::vector<Cell>& path);
+
+private:
+    int m_rows;
+    int m_columns;
+    int m_region_size;
+    int m_region_columns;
+
+    // The entries are replaced in order once the cache is full.
+    std::vector<Entry>                m_entries;
+    std::unordered_map<uint64_t, int> m_slots;
+    int                               m_next_slot;
+
+    // The entries crossing each tile (slot and generation; entries replaced since are skipped).
+    std::vector<std::vector<std::pair<int, uint32_t>>> m_tiles;
+
+    // Scratch space for joining paths.
+    std::vector<Cell> m_piece;
+    std::vector<Cell> m_join;
+    std::vector<int>  m_positions;
+
+    Stats m_stats;
+    int   m_nodes_expanded;
+};
@@ -0,0 +1,69 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "maps/clearance.h"
+
+#include <algorithm>
+
+ClearanceMap::ClearanceMap(int rows, int columns)
+  : m_rows(rows)
+  , m_columns(columns)
+  , m_values(rows * columns, 0)
+{
+}
+
+void ClearanceMap::rebuild(const CollisionGrid& collision)
+{
+    for (int row = m_rows - 1; row >= 0; --row) {
+        for (int col = m_columns - 1; col >= 0; --col) {
+            m_values[row * m_columns + col] = calculate(collision, row, col);
+        }
+    }
+}
+
+void ClearanceMap::update(const CollisionGrid& collision, int row, int column)
+{
+    if (row < 0 || column < 0 || row >= m_rows || column >= m_columns) {
+        return;
+    }
+
+    // A tile further than the cap from the change cannot be affected by it.
+    const auto first_column = std::max(0, column - MAX_CLEARANCE + 1);
+
+    for (int r = row; r >= 0 && r > row - MAX_CLEARANCE; --r) {
+        auto changed = false;
+
+        for (int c = column; c >= first_column; --c) {
+            const auto value = calculate(collision, r, c);
+
+            if (m_values[r * m_columns + c] != value) {
+                m_values[r * m_columns + c] = value;
+                changed                     = true;
+            }
+        }
+
+        // The rows above only depend on this one.
+        if (!changed) {
+            break;
+        }
+    }
+}
+
+size_t ClearanceMap::memory_usage() const
+{
+    return m_values.capacity() * sizeof(uint8_t);
+}
+
+uint8_t ClearanceMap::calculate(const CollisionGrid& collision, int row, int column) const
+{
+    if (collision.blocked(row, column)) {
+        return 0;
+    }
+
+    const auto smallest = std::min({ clearance(row + 1, column), clearance(row, column + 1),
+                                     clearance(row + 1, column + 1) });
+
+    return std::min(smallest + 1, MAX_CLEARANCE);
+}
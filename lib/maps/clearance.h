@@ -0,0 +1,62 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "maps/collision.h"
+
+// ClearanceMap stores for every tile the size of the largest square of free tiles that has the
+// tile as its top left corner. An agent covering a square of N by N tiles can stand on every
+// tile with a clearance of at least N.
+//
+// The clearance of a tile only depends on the tiles below and to the right of it, so a change
+// only has to be carried up and to the left. Clearance is capped at MAX_CLEARANCE which keeps
+// the tiles affected by a change to a small block.
+//
+// See: https://harablog.wordpress.com/2009/01/29/clearance-based-pathfinding/
+class ClearanceMap
+{
+public:
+    // The largest clearance stored (larger squares are reported as this size).
+    static constexpr int MAX_CLEARANCE = 16;
+
+public:
+    // Create a map for a grid of the given size (every tile is blocked until rebuilt).
+    explicit ClearanceMap(int rows, int columns);
+
+public:
+    // Compute the clearance of every tile.
+    void rebuild(const CollisionGrid& collision);
+
+    // Update the clearance after a tile of the collision grid has changed.
+    void update(const CollisionGrid& collision, int row, int column);
+
+    // Return the clearance of a tile (0 for blocked tiles and tiles outside of the grid).
+    int clearance(int row, int column) const
+    {
+        if (row < 0 || column < 0 || row >= m_rows || column >= m_columns) {
+            return 0;
+        }
+
+        return m_values[row * m_columns + column];
+    }
+
+    // Return the number of bytes allocated by the map.
+    size_t memory_usage() const;
+
+private:
+    // Compute the clearance of a tile from its neighbors below and to the right.
+    uint8_t calculate(const CollisionGrid& collision, int row, int column) const;
+
+private:
+    int m_rows;
+    int m_columns;
+
+    std::vector<uint8_t> m_values;
+};
@@ -0,0 +1,257 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "maps/collision.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+CollisionGrid::CollisionGrid()
+  : m_rows(0)
+  , m_columns(0)
+  , m_words_per_row(0)
+{
+}
+
+CollisionGrid::CollisionGrid(int rows, int columns)
+  : CollisionGrid()
+{
+    resize(rows, columns);
+}
+
+void CollisionGrid::resize(int rows, int columns)
+{
+    m_rows          = rows;
+    m_columns       = columns;
+    m_words_per_row = (columns + 63) / 64;
+
+    m_bits.assign(m_rows * m_words_per_row, 0);
+}
+
+int CollisionGrid::rows() const
+{
+    return m_rows;
+}
+
+int CollisionGrid::columns() const
+{
+    return m_columns;
+}
+
+void CollisionGrid::set_blocked(int row, int column, bool blocked)
+{
+    if (!contains(row, column)) {
+        return;
+    }
+
+    auto& word = m_bits[row * m_words_per_row + (column >> 6)];
+
+    if (blocked) {
+        word |= uint64_t(1) << (column & 63);
+    } else {
+        word &= ~(uint64_t(1) << (column & 63));
+    }
+}
+
+bool CollisionGrid::line_of_sight(int row0, int column0, int row1, int column1) const
+{
+    const auto rows    = std::abs(row1 - row0);
+    const auto columns = std::abs(column1 - column0);
+    const auto sr      = row1 > row0 ? 1 : -1;
+    const auto sc      = column1 > column0 ? 1 : -1;
+
+    // Going up or left the line leaves the first tile straight away.
+    const auto row_offset    = sr > 0 ? 1 : 0;
+    const auto column_offset = sc > 0 ? 1 : 0;
+
+    auto row    = row0;
+    auto column = column0;
+
+    // Walk every tile the line touches, stepping over whichever tile border the line crosses next.
+    for (int r = 0, c = 0; r < rows || c < columns;) {
+        auto decision = 0;
+
+        if (r >= rows) {
+            decision = -1;
+        } else if (c >= columns) {
+            decision = 1;
+        } else {
+            // Compare when the line reaches the next column and the next row border. On a tie the
+            // direction decides which border is crossed first (points on a border belong to the tile
+            // below or to the right of it).
+            decision = (c + column_offset) * rows - (r + row_offset) * columns;
+
+            if (decision == 0) {
+                decision = sr * columns - sc * rows;
+            }
+        }
+
+        if (decision == 0) {
+            // Through the corner.
+            if (blocked(row + sr, column) || blocked(row, column + sc)) {
+                return false;
+            }
+
+            row += sr;
+            column += sc;
+            ++r;
+            ++c;
+        } else if (decision < 0) {
+            column += sc;
+            ++c;
+        } else {
+            row += sr;
+            ++r;
+        }
+
+        if (blocked(row, column)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+float CollisionGrid::raycast(float x0, float y0, float x1, float y1) const
+{
+    auto column = static_cast<int>(std::floor(x0));
+    auto row    = static_cast<int>(std::floor(y0));
+
+    const auto end_column = static_cast<int>(std::floor(x1));
+    const auto end_row    = static_cast<int>(std::floor(y1));
+
+    const auto dx = x1 - x0;
+    const auto dy = y1 - y0;
+
+    // Along a row the blocked tiles are found a word at a time.
+    if (row == end_row) {
+        if (column == end_column) {
+            return 1.0f;
+        }
+
+        const auto sc = end_column > column ? 1 : -1;
+
+        if (const auto hit = first_blocked(row, column + sc, end_column); hit != NONE_BLOCKED) {
+            return (sc > 0 ? hit - x0 : x0 - (hit + 1)) / std::abs(dx);
+        }
+
+        return 1.0f;
+    }
+
+    const auto infinity = std::numeric_limits<float>::infinity();
+
+    const auto sc = dx > 0 ? 1 : -1;
+    const auto sr = dy > 0 ? 1 : -1;
+
+    // The fraction of the line between two column (or row) borders and until the next one.
+    const auto delta_x = dx != 0 ? 1.0f / std::abs(dx) : infinity;
+    const auto delta_y = dy != 0 ? 1.0f / std::abs(dy) : infinity;
+
+    auto next_x = dx > 0 ? (column + 1 - x0) * delta_x : dx < 0 ? (x0 - column) * delta_x : infinity;
+    auto next_y = dy > 0 ? (row + 1 - y0) * delta_y : dy < 0 ? (y0 - row) * delta_y : infinity;
+
+    // Every tile crossed is entered through one border, except through a corner which takes two.
+    for (auto steps = std::abs(end_column - column) + std::abs(end_row - row); steps > 0; --steps) {
+        float fraction;
+
+        if (next_x < next_y) {
+            fraction = next_x;
+            next_x += delta_x;
+            column += sc;
+        } else if (next_y < next_x) {
+            fraction = next_y;
+            next_y += delta_y;
+            row += sr;
+        } else {
+            // Through the corner (the same rule as line_of_sight()).
+            fraction = next_x;
+
+            if (blocked(row + sr, column) || blocked(row, column + sc)) {
+                return fraction;
+            }
+
+            next_x += delta_x;
+            next_y += delta_y;
+            column += sc;
+            row += sr;
+            --steps;
+        }
+
+        if (blocked(row, column)) {
+            return std::min(fraction, 1.0f);
+        }
+    }
+
+    return 1.0f;
+}
+
+int CollisionGrid::first_blocked(int row, int column0, int column1) const
+{
+    if (row < 0 || row >= m_rows) {
+        return column0;
+    }
+
+    // Columns outside of the grid are blocked.
+    if (column0 < 0 || column0 >= m_columns) {
+        return column0;
+    }
+
+    const auto  forward = column1 >= column0;
+    const auto  last    = std::clamp(column1, 0, m_columns - 1);
+    const auto* words   = row_data(row);
+
+    if (forward) {
+        for (auto column = column0; column <= last; column = (column | 63) + 1) {
+            // The bits from this column up to the end of the word (or the last column).
+            auto bits = words[column >> 6] >> (column & 63);
+
+            if (const auto count = last - column + 1; count < 64) {
+                bits &= (uint64_t(1) << count) - 1;
+            }
+
+            if (bits != 0) {
+                return column + std::countr_zero(bits);
+            }
+        }
+    } else {
+        for (auto column = column0; column >= last; column = (column & ~63) - 1) {
+            // The bits from the start of the word (or the last column) up to this column.
+            auto bits = words[column >> 6] << (63 - (column & 63));
+
+            if (const auto count = column - last + 1; count < 64) {
+                bits &= ~uint64_t(0) << (64 - count);
+            }
+
+            if (bits != 0) {
+                return column - std::countl_zero(bits);
+            }
+        }
+    }
+
+    // Ran past the right edge (m_columns) or the left edge (-1) of the grid.
+    if (last != column1) {
+        return forward ? m_columns : -1;
+    }
+
+    return NONE_BLOCKED;
+}
+
+int CollisionGrid::words_per_row() const
+{
+    return m_words_per_row;
+}
+
+const uint64_t* CollisionGrid::row_data(int row) const
+{
+    return &m_bits[row * m_words_per_row];
+}
+
+size_t CollisionGrid::memory_usage() const
+{
+    return m_bits.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CollisionGrid is a packed bitmap of the tiles that cannot be walked through. Each row
+// is stored as a sequence of 64-bit words (bit n of a word is column n of that word) so
+// that whole runs of tiles can be tested at once.
+class CollisionGrid
+{
+public:
+    // Returned by first_blocked() when every column is free (any column can be blocked, even -1
+    // which is outside of the grid).
+    static const int NONE_BLOCKED = INT_MIN;
+
+public:
+    // Create an empty grid.
+    explicit CollisionGrid();
+
+    // Create a grid with every tile walkable.
+    explicit CollisionGrid(int rows, int columns);
+
+public:
+    // Resize the grid (every tile becomes walkable).
+    void resize(int rows, int columns);
+
+    // Return the number of rows.
+    int rows() const;
+
+    // Return the number of columns.
+    int columns() const;
+
+    // Return true if the position is inside the grid.
+    bool contains(int row, int column) const
+    {
+        return row >= 0 && column >= 0 && row < m_rows && column < m_columns;
+    }
+
+    // Return true if the tile is blocked. Tiles outside of the grid are always blocked.
+    bool blocked(int row, int column) const
+    {
+        if (!contains(row, column)) {
+            return true;
+        }
+
+        return (m_bits[row * m_words_per_row + (column >> 6)] >> (column & 63)) & 1;
+    }
+
+    // Set whether a tile is blocked.
+    void set_blocked(int row, int column, bool blocked);
+
+    // Return true if a straight line between the top left corners of two tiles only crosses free
+    // tiles (a point belongs to the tile it is the top left corner of, or lies inside). Where the
+    // line passes exactly through the corner between tiles, both tiles beside it have to be free
+    // as well (the same rule as diagonal moves). The first tile is not tested.
+    bool line_of_sight(int row0, int column0, int row1, int column1) const;
+
+    // Cast a ray between two points in tile units (x is the column and y the row) and return the
+    // fraction of the way travelled before the ray enters a blocked tile, or 1 if the whole line is
+    // free. The tiles are walked in order with a DDA (Amanatides & Woo) and rays within a single row
+    // test whole words of the bitmap at once. The first tile is not tested.
+    float raycast(float x0, float y0, float x1, float y1) const;
+
+    // Return the first blocked column between two columns of a row (inclusive, searching from the
+    // first towards the second), or NONE_BLOCKED if they are all free. Columns outside of the grid
+    // are blocked, so a search that runs past either edge returns the column just beyond it.
+    int first_blocked(int row, int column0, int column1) const;
+
+    // Return the number of 64-bit words in a row.
+    int words_per_row() const;
+
+    // Return the packed words of a row.
+    const uint64_t* row_data(int row) const;
+
+    // Return the number of bytes allocated by the grid.
+    size_t memory_usage() const;
+
+private:
+    int m_rows;
+    int m_columns;
+    int m_words_per_row;
+
+    std::vector<uint64_t> m_bits;
+};
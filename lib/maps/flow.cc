@@ -0,0 +1,169 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "maps/flow.h"
+
+// The neighbors of a tile. Opposite directions are next to each other (the opposite of
+// direction i is i ^ 1).
+static const int NEIGHBOR_OFFSETS[8][2] = {
+    { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 }, { -1, -1 }, { 1, 1 }, { -1, 1 }, { 1, -1 },
+};
+
+// Every pending cost fits in the buckets since no move costs more than a diagonal.
+static const int BUCKET_COUNT = SearchGraph::DIAGONAL_COST + 1;
+
+FlowField::FlowField(const CollisionGrid& collision, uint32_t range)
+  : m_collision(collision)
+  , m_range(range)
+  , m_root({ -1, -1 })
+  , m_valid(false)
+  , m_buckets(BUCKET_COUNT)
+{
+}
+
+void FlowField::invalidate()
+{
+    m_valid = false;
+}
+
+bool FlowField::update(Cell root)
+{
+    if (m_valid && root == m_root) {
+        return false;
+    }
+
+    // The grid may have been resized since the last update.
+    if (const auto size = static_cast<size_t>(m_collision.rows() * m_collision.columns()); m_distances.size() != size) {
+        m_distances.assign(size, UNREACHABLE);
+        m_directions.assign(size, NO_DIRECTION);
+        m_visited.clear();
+    }
+
+    // Only the tiles of the previous field have to be cleared.
+    for (auto index : m_visited) {
+        m_distances[index]  = UNREACHABLE;
+        m_directions[index] = NO_DIRECTION;
+    }
+
+    m_visited.clear();
+
+    m_root  = root;
+    m_valid = true;
+
+    if (!m_collision.contains(root.row, root.column)) {
+        return true;
+    }
+
+    const auto root_index = index_of(root);
+
+    m_distances[root_index] = 0;
+    m_visited.push_back(root_index);
+    m_buckets[0].push_back(root_index);
+
+    // Moves are the same in both directions, so searching outwards from the root gives the
+    // distance from every tile to the root.
+    for (uint32_t cost = 0, pending = 1; pending > 0; ++cost) {
+        auto& bucket = m_buckets[cost % BUCKET_COUNT];
+
+        // No move is free, so the current bucket does not grow while it is processed.
+        for (auto index : bucket) {
+            --pending;
+
+            // The tile was reached more cheaply after it was added.
+            if (m_distances[index] != cost) {
+                continue;
+            }
+
+            const auto row    = index / m_collision.columns();
+            const auto column = index % m_collision.columns();
+
+            for (uint8_t i = 0; i < 8; ++i) {
+                const auto dr = NEIGHBOR_OFFSETS[i][0];
+                const auto dc = NEIGHBOR_OFFSETS[i][1];
+
+                if (m_collision.blocked(row + dr, column + dc)) {
+                    continue;
+                }
+
+                auto step = SearchGraph::STRAIGHT_COST;
+
+                if (dr != 0 && dc != 0) {
+                    // Do not cut the corner of a blocked tile.
+                    if (m_collision.blocked(row + dr, column) || m_collision.blocked(row, column + dc)) {
+                        continue;
+                    }
+
+                    step = SearchGraph::DIAGONAL_COST;
+                }
+
+                const auto next_cost = cost + step;
+                const auto next      = index_of({ row + dr, column + dc });
+
+                if (next_cost > m_range || next_cost >= m_distances[next]) {
+                    continue;
+                }
+
+                if (m_distances[next] == UNREACHABLE) {
+                    m_visited.push_back(next);
+                }
+
+                // Step back the way we came to get to the root.
+                m_distances[next]  = next_cost;
+                m_directions[next] = i ^ 1;
+
+                m_buckets[next_cost % BUCKET_COUNT].push_back(next);
+                ++pending;
+            }
+        }
+
+        bucket.clear();
+    }
+
+    return true;
+}
+
+FlowField::Cell FlowField::root() const
+{
+    return m_root;
+}
+
+uint32_t FlowField::distance(Cell cell) const
+{
+    if (!m_valid || !m_collision.contains(cell.row, cell.column)) {
+        return UNREACHABLE;
+    }
+
+    return m_distances[index_of(cell)];
+}
+
+FlowField::Cell FlowField::next(Cell cell) const
+{
+    if (!m_valid || !m_collision.contains(cell.row, cell.column)) {
+        return cell;
+    }
+
+    if (const auto direction = m_directions[index_of(cell)]; direction != NO_DIRECTION) {
+        return { cell.row + NEIGHBOR_OFFSETS[direction][0], cell.column + NEIGHBOR_OFFSETS[direction][1] };
+    }
+
+    return cell;
+}
+
+int FlowField::size() const
+{
+    return m_visited.size();
+}
+
+size_t FlowField::memory_usage() const
+{
+    auto bytes = m_distances.capacity() * sizeof(uint32_t) + m_directions.capacity() * sizeof(uint8_t)
+                 + m_visited.capacity() * sizeof(int);
+
+    for (const auto& bucket : m_buckets) {
+        bytes += bucket.capacity() * sizeof(int);
+    }
+
+    return bytes;
+}
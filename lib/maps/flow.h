@@ -0,0 +1,84 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "maps/collision.h"
+#include "maps/search.h"
+
+// FlowField stores the distance to a root tile (and the direction to step in) for every tile
+// around it, so that any number of entities heading for the same tile can find their next
+// step without searching for a path each.
+//
+// Moves cost the same as in SearchGraph (10 straight, 14 diagonal) which keeps the costs small
+// integers, so the field is computed with a bucketed Dijkstra (Dial's algorithm) instead of a
+// heap. Only the tiles within the range are visited.
+//
+// See: https://en.wikipedia.org/wiki/Dijkstra%27s_algorithm#Specialized_variants
+class FlowField
+{
+public:
+    using Cell = SearchGraph::Cell;
+
+    // The distance of tiles that are not in the field.
+    static constexpr uint32_t UNREACHABLE = UINT32_MAX;
+
+public:
+    // Create a new empty field over a collision grid. Tiles farther than the range (in path
+    // cost) from the root are left out of the field.
+    explicit FlowField(const CollisionGrid& collision, uint32_t range);
+
+public:
+    // Compute the field again on the next update (ex. the walls have changed).
+    void invalidate();
+
+    // Move the root of the field. The field is only computed again if the root has changed tiles
+    // (or it was invalidated). Returns true if it was computed.
+    bool update(Cell root);
+
+    // Return the root of the field.
+    Cell root() const;
+
+    // Return the path cost from a tile to the root (or UNREACHABLE).
+    uint32_t distance(Cell cell) const;
+
+    // Return the neighboring tile to step to on the way to the root. The tile itself is returned
+    // for the root and tiles that are not in the field.
+    Cell next(Cell cell) const;
+
+    // Return the number of tiles in the field.
+    int size() const;
+
+    // Return the number of bytes allocated by the field.
+    size_t memory_usage() const;
+
+private:
+    // The value of tiles without a direction.
+    static constexpr uint8_t NO_DIRECTION = 8;
+
+    // Return the index of a tile in the field arrays.
+    int index_of(Cell cell) const
+    {
+        return cell.row * m_collision.columns() + cell.column;
+    }
+
+private:
+    const CollisionGrid& m_collision;
+
+    uint32_t m_range;
+    Cell     m_root;
+    bool     m_valid;
+
+    std::vector<uint32_t> m_distances;
+    std::vector<uint8_t>  m_directions;
+
+    // The tiles in the field (to reset them on the next update).
+    std::vector<int> m_visited;
+
+    std::vector<std::vector<int>> m_buckets;
+};
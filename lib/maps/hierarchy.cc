@@ -0,0 +1,572 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "maps/hierarchy.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <queue>
+
+// The cost of a path that has not been found.
+static const uint32_t UNREACHABLE = std::numeric_limits<uint32_t>::max();
+
+// The offsets of a cluster and its neighbors.
+static const int CLUSTER_OFFSETS[5][2] = {
+    { 0, 0 }, { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 },
+};
+
+// Octile distance between two cells.
+static uint32_t distance(SearchGraph::Cell a, SearchGraph::Cell b)
+{
+    const uint32_t dr = std::abs(a.row - b.row);
+    const uint32_t dc = std::abs(a.column - b.column);
+
+    return SearchGraph::STRAIGHT_COST * std::max(dr, dc)
+           + (SearchGraph::DIAGONAL_COST - SearchGraph::STRAIGHT_COST) * std::min(dr, dc);
+}
+
+SearchHierarchy::SearchHierarchy(const CollisionGrid& collision, int cluster_size)
+  : m_collision(collision)
+  , m_cluster_size(cluster_size)
+  , m_cluster_rows(0)
+  , m_cluster_columns(0)
+  , m_generation(0)
+  , m_local_costs(cluster_size * cluster_size)
+  , m_local_prev(cluster_size * cluster_size)
+  , m_nodes_expanded(0)
+{
+    invalidate_all();
+}
+
+void SearchHierarchy::invalidate(Cell cell)
+{
+    if (!m_collision.contains(cell.row, cell.column)) {
+        return;
+    }
+
+    if (const auto cluster = cluster_of(cell); !m_dirty_flags[cluster]) {
+        m_dirty_flags[cluster] = true;
+        m_dirty.push_back(cluster);
+    }
+}
+
+void SearchHierarchy::invalidate_all()
+{
+    m_cluster_rows    = (m_collision.rows() + m_cluster_size - 1) / m_cluster_size;
+    m_cluster_columns = (m_collision.columns() + m_cluster_size - 1) / m_cluster_size;
+
+    const auto clusters = m_cluster_rows * m_cluster_columns;
+    const auto nodes    = clusters * 4 * m_cluster_size;
+
+    m_entrances.assign(nodes, false);
+    m_edges.resize(nodes);
+    m_records.assign(nodes + 2, Record());
+    m_generation = 0;
+
+    m_dirty.resize(clusters);
+    m_dirty_flags.assign(clusters, true);
+
+    for (int cluster = 0; cluster < clusters; ++cluster) {
+        m_dirty[cluster] = cluster;
+    }
+}
+
+void SearchHierarchy::update()
+{
+    if (m_dirty.empty()) {
+        return;
+    }
+
+    // The entrances on every side of a changed cluster have to be placed again...
+    for (auto cluster : m_dirty) {
+        const auto row    = cluster / m_cluster_columns;
+        const auto column = cluster % m_cluster_columns;
+
+        build_border(cluster, EAST);
+        build_border(cluster, SOUTH);
+
+        if (column > 0) {
+            build_border(cluster - 1, EAST);
+        }
+
+        if (row > 0) {
+            build_border(cluster - m_cluster_columns, SOUTH);
+        }
+    }
+
+    // ...which changes the entrances of the neighbors as well.
+    for (auto cluster : m_dirty) {
+        const auto row    = cluster / m_cluster_columns;
+        const auto column = cluster % m_cluster_columns;
+
+        for (const auto& [dr, dc] : CLUSTER_OFFSETS) {
+            if (row + dr < 0 || row + dr >= m_cluster_rows || column + dc < 0 || column + dc >= m_cluster_columns) {
+                continue;
+            }
+
+            // Neighbors that are also dirty are rebuilt on their own turn.
+            const auto neighbor = cluster + dr * m_cluster_columns + dc;
+
+            if (neighbor == cluster || !m_dirty_flags[neighbor]) {
+                build_edges(neighbor);
+            }
+        }
+    }
+
+    for (auto cluster : m_dirty) {
+        m_dirty_flags[cluster] = false;
+    }
+
+    m_dirty.clear();
+}
+
+bool SearchHierarchy::find_path(Cell src, Cell dest, std::vector<Cell>& path)
+{
+    path.clear();
+
+    update();
+
+    m_nodes_expanded = 0;
+
+    if (!m_collision.contains(src.row, src.column) || m_collision.blocked(dest.row, dest.column)) {
+        return false;
+    }
+
+    const auto src_node  = static_cast<int>(m_entrances.size());
+    const auto dest_node = src_node + 1;
+
+    const auto src_cluster  = cluster_of(src);
+    const auto dest_cluster = cluster_of(dest);
+
+    // Connect the destination to the entrances of its cluster (paths inside a cluster cost the
+    // same in both directions).
+    search_cluster(dest_cluster, dest);
+
+    m_dest_edges.clear();
+
+    for (int i = 0; i < 4 * m_cluster_size; ++i) {
+        const auto node = dest_cluster * 4 * m_cluster_size + i;
+
+        if (const auto cost = local_cost(dest_cluster, cell_of_node(node)); m_entrances[node] && cost != UNREACHABLE) {
+            m_dest_edges.push_back({ node, cost });
+        }
+    }
+
+    // Connect the source to the entrances of its cluster (and straight to the destination if it is in there).
+    search_cluster(src_cluster, src);
+
+    m_src_edges.clear();
+
+    for (int i = 0; i < 4 * m_cluster_size; ++i) {
+        const auto node = src_cluster * 4 * m_cluster_size + i;
+
+        if (const auto cost = local_cost(src_cluster, cell_of_node(node)); m_entrances[node] && cost != UNREACHABLE) {
+            m_src_edges.push_back({ node, cost });
+        }
+    }
+
+    if (src_cluster == dest_cluster) {
+        if (const auto cost = local_cost(src_cluster, dest); cost != UNREACHABLE) {
+            m_src_edges.push_back({ dest_node, cost });
+        }
+    }
+
+    const auto cell_of = [&](int node) {
+        return node == src_node ? src : node == dest_node ? dest : cell_of_node(node);
+    };
+
+    // Search the abstract graph.
+    if (++m_generation == 0) {
+        for (auto& node : m_records) {
+            node.generation = 0;
+        }
+
+        m_generation = 1;
+    }
+
+    using Entry = std::pair<uint32_t, int>;
+
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+    record(src_node).cost = 0;
+    open.push({ distance(src, dest), src_node });
+
+    const auto relax = [&](int current, int next, uint32_t cost) {
+        const auto next_cost = m_records[current].cost + cost;
+
+        if (auto& next_record = record(next); !next_record.closed && next_cost < next_record.cost) {
+            next_record.cost = next_cost;
+            next_record.prev = current;
+
+            open.push({ next_cost + distance(cell_of(next), dest), next });
+        }
+    };
+
+    while (!open.empty()) {
+        const auto current = open.top().second;
+
+        open.pop();
+
+        if (m_records[current].closed) {
+            continue;
+        }
+
+        m_records[current].closed = true;
+
+        if (current == dest_node) {
+            break;
+        }
+
+        ++m_nodes_expanded;
+
+        if (current == src_node) {
+            for (const auto& edge : m_src_edges) {
+                relax(current, edge.node, edge.cost);
+            }
+
+            continue;
+        }
+
+        for (const auto& edge : m_edges[current]) {
+            relax(current, edge.node, edge.cost);
+        }
+
+        relax(current, mirror_of(current), SearchGraph::STRAIGHT_COST);
+
+        if (cluster_of_node(current) == dest_cluster) {
+            for (const auto& edge : m_dest_edges) {
+                if (edge.node == current) {
+                    relax(current, dest_node, edge.cost);
+                }
+            }
+        }
+    }
+
+    if (!record(dest_node).closed) {
+        return false;
+    }
+
+    m_abstract_path.clear();
+
+    for (auto node = dest_node; node >= 0; node = m_records[node].prev) {
+        m_abstract_path.push_back(node);
+    }
+
+    std::reverse(m_abstract_path.begin(), m_abstract_path.end());
+
+    // Refine the abstract path one segment at a time.
+    for (size_t i = 1; i < m_abstract_path.size(); ++i) {
+        const auto from = cell_of(m_abstract_path[i - 1]);
+        const auto to   = cell_of(m_abstract_path[i]);
+
+        if (from == to) {
+            continue;
+        }
+
+        // Steps between two clusters are always to the neighboring tile.
+        if (cluster_of(from) != cluster_of(to)) {
+            path.push_back(to);
+            continue;
+        }
+
+        const auto cluster = cluster_of(to);
+
+        int row, column, rows, columns;
+        cluster_bounds(cluster, row, column, rows, columns);
+
+        search_cluster(cluster, from, (to.row - row) * m_cluster_size + (to.column - column));
+        append_local_path(cluster, to, path);
+    }
+
+    return true;
+}
+
+int SearchHierarchy::nodes_expanded() const
+{
+    return m_nodes_expanded;
+}
+
+int SearchHierarchy::entrance_count() const
+{
+    return std::count(m_entrances.begin(), m_entrances.end(), true);
+}
+
+size_t SearchHierarchy::memory_usage() const
+{
+    auto bytes = m_edges.capacity() * sizeof(std::vector<Edge>);
+
+    for (const auto& edges : m_edges) {
+        bytes += edges.capacity() * sizeof(Edge);
+    }
+
+    // Bit vectors pack eight flags to a byte.
+    bytes += (m_entrances.capacity() + m_dirty_flags.capacity()) / 8;
+    bytes += m_dirty.capacity() * sizeof(int);
+    bytes += m_records.capacity() * sizeof(Record);
+    bytes += (m_src_edges.capacity() + m_dest_edges.capacity()) * sizeof(Edge);
+    bytes += m_abstract_path.capacity() * sizeof(int);
+    bytes += m_local_costs.capacity() * sizeof(uint32_t);
+    bytes += m_local_prev.capacity() * sizeof(int);
+
+    return bytes;
+}
+
+int SearchHierarchy::cluster_of(Cell cell) const
+{
+    return (cell.row / m_cluster_size) * m_cluster_columns + (cell.column / m_cluster_size);
+}
+
+int SearchHierarchy::node_of(int cluster, int side, int position) const
+{
+    return (cluster * 4 + side) * m_cluster_size + position;
+}
+
+int SearchHierarchy::cluster_of_node(int node) const
+{
+    return node / (4 * m_cluster_size);
+}
+
+SearchHierarchy::Cell SearchHierarchy::cell_of_node(int node) const
+{
+    const auto cluster  = cluster_of_node(node);
+    const auto side     = (node / m_cluster_size) % 4;
+    const auto position = node % m_cluster_size;
+
+    int row, column, rows, columns;
+    cluster_bounds(cluster, row, column, rows, columns);
+
+    switch (side) {
+    case NORTH:
+        return { row, column + position };
+    case SOUTH:
+        return { row + rows - 1, column + position };
+    case WEST:
+        return { row + position, column };
+    default:
+        return { row + position, column + columns - 1 };
+    }
+}
+
+int SearchHierarchy::mirror_of(int node) const
+{
+    const auto cluster  = cluster_of_node(node);
+    const auto position = node % m_cluster_size;
+
+    switch ((node / m_cluster_size) % 4) {
+    case NORTH:
+        return node_of(cluster - m_cluster_columns, SOUTH, position);
+    case SOUTH:
+        return node_of(cluster + m_cluster_columns, NORTH, position);
+    case WEST:
+        return node_of(cluster - 1, EAST, position);
+    default:
+        return node_of(cluster + 1, WEST, position);
+    }
+}
+
+void SearchHierarchy::cluster_bounds(int cluster, int& row, int& column, int& rows, int& columns) const
+{
+    row    = (cluster / m_cluster_columns) * m_cluster_size;
+    column = (cluster % m_cluster_columns) * m_cluster_size;
+
+    // The last clusters are cut off by the edge of the grid.
+    rows    = std::min(m_cluster_size, m_collision.rows() - row);
+    columns = std::min(m_cluster_size, m_collision.columns() - column);
+}
+
+void SearchHierarchy::build_border(int cluster, Side side)
+{
+    int row, column, rows, columns;
+    cluster_bounds(cluster, row, column, rows, columns);
+
+    const auto length = side == EAST ? rows : columns;
+
+    for (int i = 0; i < m_cluster_size; ++i) {
+        m_entrances[node_of(cluster, side, i)] = false;
+    }
+
+    // There is nothing on the other side of the grid edge.
+    if ((side == EAST && column + columns >= m_collision.columns())
+        || (side == SOUTH && row + rows >= m_collision.rows())) {
+        return;
+    }
+
+    const auto neighbor = side == EAST ? cluster + 1 : cluster + m_cluster_columns;
+    const auto opposite = side == EAST ? WEST : NORTH;
+
+    for (int i = 0; i < m_cluster_size; ++i) {
+        m_entrances[node_of(neighbor, opposite, i)] = false;
+    }
+
+    // Return true if both tiles at a position along the border are walkable.
+    const auto open = [&](int i) {
+        if (side == EAST) {
+            return !m_collision.blocked(row + i, column + columns - 1) && !m_collision.blocked(row + i, column + columns);
+        }
+
+        return !m_collision.blocked(row + rows - 1, column + i) && !m_collision.blocked(row + rows, column + i);
+    };
+
+    const auto add = [&](int i) {
+        m_entrances[node_of(cluster, side, i)]       = true;
+        m_entrances[node_of(neighbor, opposite, i)] = true;
+    };
+
+    for (int start = 0; start < length;) {
+        if (!open(start)) {
+            ++start;
+            continue;
+        }
+
+        auto end = start;
+
+        while (end < length && open(end)) {
+            ++end;
+        }
+
+        // Long runs get an entrance at each end so that paths do not detour through the middle.
+        if (end - start >= ENTRANCE_SPLIT) {
+            add(start);
+            add(end - 1);
+        } else {
+            add(start + (end - start) / 2);
+        }
+
+        start = end;
+    }
+}
+
+void SearchHierarchy::build_edges(int cluster)
+{
+    const auto first = node_of(cluster, NORTH, 0);
+    const auto last  = first + 4 * m_cluster_size;
+
+    for (auto node = first; node < last; ++node) {
+        m_edges[node].clear();
+
+        if (!m_entrances[node]) {
+            continue;
+        }
+
+        search_cluster(cluster, cell_of_node(node));
+
+        for (auto other = first; other < last; ++other) {
+            if (other == node || !m_entrances[other]) {
+                continue;
+            }
+
+            if (const auto cost = local_cost(cluster, cell_of_node(other)); cost != UNREACHABLE) {
+                m_edges[node].push_back({ other, cost });
+            }
+        }
+    }
+}
+
+void SearchHierarchy::search_cluster(int cluster, Cell src, int target)
+{
+    int row, column, rows, columns;
+    cluster_bounds(cluster, row, column, rows, columns);
+
+    std::fill(m_local_costs.begin(), m_local_costs.end(), UNREACHABLE);
+    std::fill(m_local_prev.begin(), m_local_prev.end(), -1);
+
+    using Entry = std::pair<uint32_t, int>;
+
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+    const auto src_index = (src.row - row) * m_cluster_size + (src.column - column);
+
+    m_local_costs[src_index] = 0;
+    open.push({ 0, src_index });
+
+    while (!open.empty()) {
+        const auto [cost, current] = open.top();
+
+        open.pop();
+
+        if (cost > m_local_costs[current]) {
+            continue;
+        }
+
+        if (current == target) {
+            return;
+        }
+
+        ++m_nodes_expanded;
+
+        const auto r = current / m_cluster_size;
+        const auto c = current % m_cluster_size;
+
+        for (int dr = -1; dr <= 1; ++dr) {
+            for (int dc = -1; dc <= 1; ++dc) {
+                if ((dr == 0 && dc == 0) || r + dr < 0 || r + dr >= rows || c + dc < 0 || c + dc >= columns) {
+                    continue;
+                }
+
+                if (m_collision.blocked(row + r + dr, column + c + dc)) {
+                    continue;
+                }
+
+                auto step = SearchGraph::STRAIGHT_COST;
+
+                if (dr != 0 && dc != 0) {
+                    // Do not cut the corner of a blocked tile.
+                    if (m_collision.blocked(row + r + dr, column + c) || m_collision.blocked(row + r, column + c + dc)) {
+                        continue;
+                    }
+
+                    step = SearchGraph::DIAGONAL_COST;
+                }
+
+                if (const auto next = current + dr * m_cluster_size + dc; cost + step < m_local_costs[next]) {
+                    m_local_costs[next] = cost + step;
+                    m_local_prev[next]  = current;
+
+                    open.push({ cost + step, next });
+                }
+            }
+        }
+    }
+}
+
+uint32_t SearchHierarchy::local_cost(int cluster, Cell cell) const
+{
+    int row, column, rows, columns;
+    cluster_bounds(cluster, row, column, rows, columns);
+
+    return m_local_costs[(cell.row - row) * m_cluster_size + (cell.column - column)];
+}
+
+void SearchHierarchy::append_local_path(int cluster, Cell cell, std::vector<Cell>& path) const
+{
+    int row, column, rows, columns;
+    cluster_bounds(cluster, row, column, rows, columns);
+
+    const auto start = path.size();
+
+    // The source has no previous tile and is not part of the path.
+    for (auto index = (cell.row - row) * m_cluster_size + (cell.column - column); m_local_prev[index] >= 0;
+         index      = m_local_prev[index]) {
+        path.push_back({ row + index / m_cluster_size, column + index % m_cluster_size });
+    }
+
+    std::reverse(path.begin() + start, path.end());
+}
+
+SearchHierarchy::Record& SearchHierarchy::record(int node)
+{
+    auto& result = m_records[node];
+
+    if (result.generation != m_generation) {
+        result.generation = m_generation;
+        result.cost       = UNREACHABLE;
+        result.prev       = -1;
+        result.closed     = false;
+    }
+
+    return result;
+}
@@ -0,0 +1,153 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "maps/collision.h"
+#include "maps/search.h"
+
+// SearchHierarchy is an abstract graph over the collision grid for hierarchical path-finding
+// (HPA*). The grid is split into square clusters and every run of walkable tiles along the
+// border of two clusters gets one or two entrances. Entrances of the same cluster are linked
+// by the cost of the shortest path between them inside the cluster.
+//
+// A query connects the source and destination to the entrances of their clusters, searches
+// the (much smaller) abstract graph and then only refines the segments of that path inside
+// each cluster. Paths are close to, but not always exactly, the shortest.
+//
+// When a tile changes only its cluster (and the entrances it shares with its neighbors) is
+// rebuilt, at the start of the next query.
+//
+// See: https://webdocs.cs.ualberta.ca/~mmueller/ps/hpastar.pdf
+class SearchHierarchy
+{
+public:
+    using Cell = SearchGraph::Cell;
+
+    // The default width and height of a cluster (in tiles).
+    static const int DEFAULT_CLUSTER_SIZE = 10;
+
+public:
+    // Create a new hierarchy over a collision grid. Every cluster is built on the first query.
+    explicit SearchHierarchy(const CollisionGrid& collision, int cluster_size = DEFAULT_CLUSTER_SIZE);
+
+public:
+    // Mark the cluster of a cell to be rebuilt.
+    void invalidate(Cell cell);
+
+    // Mark every cluster to be rebuilt (ex. the grid was resized or reloaded).
+    void invalidate_all();
+
+    // Rebuild the clusters marked since the last update.
+    void update();
+
+    // Find a path from source to destination. The path excludes the source and ends with the
+    // destination. Returns false (with an empty path) if the destination cannot be reached.
+    bool find_path(Cell src, Cell dest, std::vector<Cell>& path);
+
+    // Return the number of abstract and cluster nodes expanded by the last query.
+    int nodes_expanded() const;
+
+    // Return the number of entrances in the abstract graph.
+    int entrance_count() const;
+
+    // Return the number of bytes allocated by the hierarchy.
+    size_t memory_usage() const;
+
+private:
+    // The sides of a cluster.
+    enum Side
+    {
+        NORTH = 0,
+        SOUTH = 1,
+        WEST  = 2,
+        EAST  = 3,
+    };
+
+    struct Edge
+    {
+        int      node;
+        uint32_t cost;
+    };
+
+    struct Record
+    {
+        uint32_t generation;
+        uint32_t cost;
+        int32_t  prev;
+        bool     closed;
+    };
+
+    // Runs of walkable border tiles at least this long get an entrance at each end.
+    static const int ENTRANCE_SPLIT = 6;
+
+    // Return the cluster containing a cell.
+    int cluster_of(Cell cell) const;
+
+    // Return the entrance node at a position along a side of a cluster.
+    int node_of(int cluster, int side, int position) const;
+
+    // Return the cluster of an entrance node.
+    int cluster_of_node(int node) const;
+
+    // Return the cell of a node.
+    Cell cell_of_node(int node) const;
+
+    // Return the entrance on the other side of the cluster border.
+    int mirror_of(int node) const;
+
+    // Return the bounds of a cluster.
+    void cluster_bounds(int cluster, int& row, int& column, int& rows, int& columns) const;
+
+    // Place the entrances on the east or south border of a cluster (and the matching side of its neighbor).
+    void build_border(int cluster, Side side);
+
+    // Link the entrances of a cluster.
+    void build_edges(int cluster);
+
+    // Find the cost of the shortest path from a cell to every tile inside its cluster (stopping
+    // early once the target is reached, if given).
+    void search_cluster(int cluster, Cell src, int target = -1);
+
+    // Return the local cost of a cell after search_cluster() (or UINT32_MAX if unreachable).
+    uint32_t local_cost(int cluster, Cell cell) const;
+
+    // Append the path from the source of the last search_cluster() to a cell inside the cluster.
+    void append_local_path(int cluster, Cell cell, std::vector<Cell>& path) const;
+
+    // Return the node record for an abstract node, resetting it if it is from an earlier query.
+    Record& record(int node);
+
+private:
+    const CollisionGrid& m_collision;
+
+    int m_cluster_size;
+    int m_cluster_rows;
+    int m_cluster_columns;
+
+    // Entrances are stored by their position along the cluster sides so that rebuilding a
+    // cluster never renumbers the entrances of its neighbors.
+    std::vector<bool>              m_entrances;
+    std::vector<std::vector<Edge>> m_edges;
+
+    std::vector<int>  m_dirty;
+    std::vector<bool> m_dirty_flags;
+
+    // Abstract search state (the source and destination are the two nodes after the entrances).
+    std::vector<Record> m_records;
+    std::vector<Edge>   m_src_edges;
+    std::vector<Edge>   m_dest_edges;
+    std::vector<int>    m_abstract_path;
+    uint32_t            m_generation;
+
+    // Cluster search state.
+    std::vector<uint32_t> m_local_costs;
+    std::vector<int>      m_local_prev;
+
+    int m_nodes_expanded;
+};
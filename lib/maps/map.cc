@@ -26,6 +26,33 @@ static const auto MINIMAP_SCALE = 20;
 // The minimap dot size.
 static const auto MINIMAP_DOT_SIZE = 2;
 
+// The farthest an entity sprite (or its jump) can be drawn from the entity center.
+static const auto CULL_MARGIN = CHARACTER_HEIGHT * 3;
+
+// The distance (in pixels) within which entities are updated every frame.
+static const auto FULL_DETAIL_RADIUS = 16 * MAP_TILE_SIZE;
+
+// The distance (in pixels) within which entities are updated every few frames (beyond it they
+// sleep until the player comes closer).
+static const auto REDUCED_DETAIL_RADIUS = 40 * MAP_TILE_SIZE;
+
+// The number of frames between two updates of an entity at reduced detail.
+static const uint32_t REDUCED_DETAIL_INTERVAL = 4;
+
+// The longest time (in milliseconds) an entity is moved by in one update, so that a long gap does
+// not let it jump through walls.
+static const uint32_t MAX_UPDATE_TICKS = 250;
+
+// How long (in milliseconds) an entity stays at full detail after being woken up.
+static const uint32_t WAKE_TIME = 5000;
+
+// The distance (in pixels) within which most enemies chase the player.
+static const auto AGGRO_RADIUS = 10 * MAP_TILE_SIZE;
+
+// The path cost from the player within which the flow field is kept (walls can make the way to
+// an enemy inside the aggro radius a lot longer than the straight line).
+static const auto FLOW_FIELD_RANGE = 3 * (AGGRO_RADIUS / MAP_TILE_SIZE) * SearchGraph::STRAIGHT_COST;
+
 // Decode a Base64 encoded string.
 //
 // Reference: https://stackoverflow.com/questions/180947/base64-decode-snippet-in-c
@@ -149,8 +176,18 @@ bool zlib_inflate(const char* source, std::size_t inSize, std::vector<unsigned c
 Map::Map(Game& game, Entity& player)
   : m_game(game)
   , m_player(player)
+  , m_ai(*this, m_components, player)
+  , m_animation_events(game)
   , m_search_graph(m_tiles)
+  , m_pathfinder(MAP_TILE_ROW_COUNT, MAP_TILE_COL_COUNT, Entity::PATH_AGENT_SIZE)
+  , m_flow_field(m_search_graph.agent_collision(), FLOW_FIELD_RANGE)
+  , m_update_frame(0)
+  , m_simulation_stats()
+  , m_render_frame(0)
+  , m_render_stats()
 {
+    m_search_graph.set_agent_size(Entity::PATH_AGENT_SIZE);
+
     for (int i = 0; i < MAP_TILE_SPRITESHEET_ROW_COUNT; ++i) {
         for (int j = 0; j < MAP_TILE_SPRITESHEET_COL_COUNT; ++j) {
             m_clips[j + (i * MAP_TILE_SPRITESHEET_COL_COUNT)] = { j * MAP_TILE_SIZE, i * MAP_TILE_SIZE, MAP_TILE_SIZE,
@@ -179,8 +216,9 @@ bool Map::initialize()
     m_camera.w = m_game.window.width();
     m_camera.h = m_game.window.height();
 
-    // Push the player to the front.
-    m_entities.insert(m_entities.begin(), &m_player);
+    // The player is owned by the game so it is only attached to the map storage.
+    m_player.set_handle(m_entities.attach(m_player));
+    m_spatial_grid.insert(&m_player);
 
     return true;
 }
@@ -294,38 +332,43 @@ bool Map::load_level(int level)
         } else {
             LOG_DEBUG << "Parsing object layer...\n";
 
-            auto iter = m_entities.begin();
+            // The queue is rebuilt on the next render.
+            m_render_queue.clear();
 
-            while (iter != m_entities.end()) {
-                if (auto entity = *iter; !entity->is_player()) {
-                    delete entity;
-                    m_entities.erase(iter);
-                } else {
-                    ++iter;
+            // Remove the enemies of the previous level (the player is not owned by the map). Going
+            // backwards only ever moves entities that have already been visited.
+            for (auto i = m_entities.size(); i-- > 0;) {
+                if (auto entity = m_entities.objects()[i]; !entity->is_player()) {
+                    despawn(entity->handle());
                 }
             }
 
+            // The hits from the previous level have nobody left to land on.
+            m_game.combat.clear();
+
             for (const auto& object : layer["objects"].GetArray()) {
                 const auto name = object["name"].GetString();
 
                 if (strcmp(name, "Enemy") == 0) {
-                    auto enemy = new Entity(Entity::ENEMY_TYPE, m_game);
-                    enemy->set_position(object["x"].GetInt(), object["y"].GetInt() - CHARACTER_HEIGHT);
-
                     auto type = std::stoi(std::string(object["type"].GetString()));
 
-                    if (!enemy->set_sprite(static_cast<Entity::Sprite>(type))) {
+                    if (!spawn(Entity::ENEMY_TYPE, type, object["x"].GetInt(),
+                               object["y"].GetInt() - CHARACTER_HEIGHT)
+                           .valid()) {
                         return false;
                     }
-
-                    // Push the enemy to the back.
-                    m_entities.insert(m_entities.end(), enemy);
                 } else if (strcmp(name, "Player") == 0) {
                     m_player.set_position(object["x"].GetInt(), object["y"].GetInt() - CHARACTER_HEIGHT);
 
                     auto type = std::stoi(std::string(object["type"].GetString()));
 
-                    if (!m_player.set_sprite(static_cast<Entity::Sprite>(type))) {
+                    if (!m_player.set_archetype(type)) {
+                        return false;
+                    }
+
+                    // The skill bar is the player's only way to fight with skills.
+                    if (m_player.skills().empty()) {
+                        LOG_ERROR << "Player archetype without skills: " << m_player.archetype().name << std::endl;
                         return false;
                     }
                 }
@@ -333,6 +376,17 @@ bool Map::load_level(int level)
         }
     }
 
+    // The walls have changed.
+    m_search_graph.rebuild();
+    m_flow_field.invalidate();
+
+    // Paths requested on the previous level are no longer any use.
+    m_pathfinder.cancel_all();
+    m_pathfinder.load(m_search_graph.collision());
+
+    // The player has been moved to the start of the level.
+    m_spatial_grid.move(&m_player);
+
     if (m_level != level) {
         m_level = level;
     }
@@ -349,6 +403,15 @@ Tile& Map::at(int row, int col)
     return m_tiles[row + (col * MAP_TILE_ROW_COUNT)];
 }
 
+void Map::clear_fg(int row, int col)
+{
+    at(row, col).clear_fg();
+
+    m_search_graph.update({ row, col });
+    m_pathfinder.set_blocked({ row, col }, m_search_graph.blocked({ row, col }));
+    m_flow_field.invalidate();
+}
+
 int Map::level() const
 {
     return m_level;
@@ -356,21 +419,273 @@ int Map::level() const
 
 void Map::go_to_next_level()
 {
-    if (!load_level(m_level + 1)) {
-        LOG_ERROR << "Failed to enter next level" << std::endl;
-    }
+    m_next_level = m_level + 1;
 }
 
 void Map::go_to_prev_level()
 {
-    if (!load_level(m_level - 1)) {
-        LOG_ERROR << "Failed to enter previous level" << std::endl;
+    m_next_level = m_level - 1;
+}
+
+const std::vector<Entity*>& Map::entities() const
+{
+    return m_entities.objects();
+}
+
+Entity* Map::entity(Handle handle) const
+{
+    return m_entities.get(handle);
+}
+
+Handle Map::spawn(Entity::Type type, int archetype, int x, int y)
+{
+    const auto handle = m_entities.emplace(type, m_game);
+    const auto entity = m_entities.get(handle);
+
+    entity->set_handle(handle);
+    entity->set_position(x, y);
+
+    if (!entity->set_archetype(archetype)) {
+        m_entities.erase(handle);
+        return {};
+    }
+
+    m_spatial_grid.insert(entity);
+    m_ai.reset(entity);
+
+    return handle;
+}
+
+void Map::despawn(Handle handle)
+{
+    const auto entity = m_entities.get(handle);
+
+    if (entity == nullptr || entity->is_player()) {
+        return;
+    }
+
+    m_spatial_grid.remove(entity);
+    m_pathfinder.cancel(handle);
+
+    if (auto iter = std::find(m_render_queue.begin(), m_render_queue.end(), entity); iter != m_render_queue.end()) {
+        m_render_queue.erase(iter);
+    }
+
+    m_entities.erase(handle);
+}
+
+Components& Map::components()
+{
+    return m_components;
+}
+
+AI& Map::ai()
+{
+    return m_ai;
+}
+
+AnimationEvents& Map::animation_events()
+{
+    return m_animation_events;
+}
+
+SearchGraph& Map::search_graph()
+{
+    return m_search_graph;
+}
+
+Pathfinder& Map::pathfinder()
+{
+    return m_pathfinder;
+}
+
+const FlowField& Map::flow_field() const
+{
+    return m_flow_field;
+}
+
+const SpatialGrid& Map::spatial_grid() const
+{
+    return m_spatial_grid;
+}
+
+Separation& Map::separation()
+{
+    return m_separation;
+}
+
+bool Map::line_of_sight(float x0, float y0, float x1, float y1) const
+{
+    const auto& collision = m_search_graph.collision();
+
+    return collision.raycast(x0 / MAP_TILE_SIZE, y0 / MAP_TILE_SIZE, x1 / MAP_TILE_SIZE, y1 / MAP_TILE_SIZE) >= 1.0f;
+}
+
+void Map::line_of_sight(float x, float y, const std::vector<Entity*>& entities, std::vector<uint8_t>& visible) const
+{
+    const auto& collision = m_search_graph.collision();
+
+    const auto origin_x = x / MAP_TILE_SIZE;
+    const auto origin_y = y / MAP_TILE_SIZE;
+
+    visible.resize(entities.size());
+
+    for (size_t i = 0; i < entities.size(); ++i) {
+        const auto target_x = entities[i]->center_x() / MAP_TILE_SIZE;
+        const auto target_y = entities[i]->center_y() / MAP_TILE_SIZE;
+
+        visible[i] = collision.raycast(origin_x, origin_y, target_x, target_y) >= 1.0f;
     }
 }
 
-std::vector<Entity*>& Map::entities()
+bool Map::raycast(float x0, float y0, float& x1, float& y1) const
 {
-    return m_entities;
+    const auto& collision = m_search_graph.collision();
+
+    const auto fraction =
+      collision.raycast(x0 / MAP_TILE_SIZE, y0 / MAP_TILE_SIZE, x1 / MAP_TILE_SIZE, y1 / MAP_TILE_SIZE);
+
+    if (fraction >= 1.0f) {
+        return false;
+    }
+
+    x1 = x0 + (x1 - x0) * fraction;
+    y1 = y0 + (y1 - y0) * fraction;
+
+    return true;
+}
+
+void Map::update(uint32_t ticks)
+{
+    // Paths requested during the last frame get their share of the worker's time.
+    m_pathfinder.begin_frame();
+
+    const auto now = SDL_GetTicks();
+
+    auto& detail = m_components.detail;
+
+    m_simulation_stats = {};
+
+    for (auto entity : m_entities.objects()) {
+        const auto i    = entity->component_index();
+        const auto tier = detail_tier(entity, now);
+
+        detail.tier[i] = tier;
+        detail.pending[i] += ticks;
+
+        if (tier == Components::DORMANT) {
+            // Asleep: the time passes without the entity.
+            ++m_simulation_stats.dormant;
+
+            detail.pending[i]             = 0;
+            m_components.motion.paused[i] = true;
+            continue;
+        }
+
+        if (tier == Components::REDUCED_DETAIL) {
+            ++m_simulation_stats.reduced_detail;
+
+            // Staggered by slot so the same share of these entities is updated on every frame.
+            if ((m_update_frame + i) % REDUCED_DETAIL_INTERVAL != 0) {
+                m_components.motion.paused[i] = true;
+                continue;
+            }
+        } else {
+            ++m_simulation_stats.full_detail;
+        }
+
+        ++m_simulation_stats.updated;
+
+        const auto elapsed = std::min(detail.pending[i], MAX_UPDATE_TICKS);
+
+        detail.pending[i] = 0;
+
+        entity->check_collision();
+        entity->update(elapsed);
+
+        // Enemies stop attacking once the player walks away.
+        if (!entity->is_player() && entity->attacking() && !entity->is_near_entity(&m_player)) {
+            entity->stop_attacking();
+        }
+    }
+
+    ++m_update_frame;
+
+    // The footsteps and hits of the animations, now that every entity has been updated.
+    m_animation_events.dispatch();
+
+    // Move everyone at once over the component arrays (the entities skipped this frame are paused).
+    m_components.integrate();
+
+    for (auto entity : m_entities.objects()) {
+        m_spatial_grid.move(entity);
+    }
+
+    // Push apart the entities that walked into each other.
+    m_separation.resolve(m_spatial_grid, m_search_graph.agent_collision(), m_components, m_moved_buffer);
+
+    for (auto entity : m_moved_buffer) {
+        m_spatial_grid.move(entity);
+    }
+
+    // Change levels only after all entities have been updated since it replaces them.
+    if (m_next_level.has_value()) {
+        const auto level = *m_next_level;
+
+        m_next_level.reset();
+
+        if (!load_level(level)) {
+            LOG_ERROR << "Failed to enter level: " << level << std::endl;
+        }
+    }
+
+    if (m_player.dead()) {
+        return;
+    }
+
+    // Enemies chasing the player all follow the same field, which only changes when the player changes tiles.
+    m_flow_field.update(m_player.cell());
+
+    // The enemies scheduled for this frame decide what to do next.
+    m_ai.update();
+}
+
+void Map::wake(Entity* entity)
+{
+    m_components.detail.awake_until[entity->component_index()] = SDL_GetTicks() + WAKE_TIME;
+}
+
+bool Map::on_screen(const Entity* entity) const
+{
+    // Stamped as queued by the last update_render_queue().
+    return entity->render_frame() == m_render_frame + 1;
+}
+
+const Map::SimulationStats& Map::simulation_stats() const
+{
+    return m_simulation_stats;
+}
+
+Components::Tier Map::detail_tier(const Entity* entity, uint32_t now) const
+{
+    if (entity->is_player() || on_screen(entity)
+        || static_cast<int32_t>(m_components.detail.awake_until[entity->component_index()] - now) > 0) {
+        return Components::FULL_DETAIL;
+    }
+
+    const auto dx       = entity->center_x() - m_player.center_x();
+    const auto dy       = entity->center_y() - m_player.center_y();
+    const auto distance = dx * dx + dy * dy;
+
+    if (distance <= FULL_DETAIL_RADIUS * FULL_DETAIL_RADIUS) {
+        return Components::FULL_DETAIL;
+    }
+
+    if (distance <= REDUCED_DETAIL_RADIUS * REDUCED_DETAIL_RADIUS) {
+        return Components::REDUCED_DETAIL;
+    }
+
+    return Components::DORMANT;
 }
 
 int Map::camera_offset_x(int x) const
@@ -461,16 +776,89 @@ void Map::render()
         }
     }
 
-    std::sort(m_entities.begin(), m_entities.end(), [](Entity* a, Entity* b) {
-        return a->pos_y() > b->pos_y();
-    });
+    update_render_queue();
 
-    for (auto iter = m_entities.rbegin(); iter != m_entities.rend(); ++iter) {
-        (*iter)->render(m_camera);
+    for (auto entity : m_render_queue) {
+        entity->render(m_camera);
     }
 
     // Render the particle effects.
     m_game.emitter.render(m_camera);
+
+    // Render the combat text over everything else on the map.
+    m_game.combat_text.render(m_camera);
+
+    m_render_stats.drawn_particles  = m_game.emitter.drawn_count();
+    m_render_stats.culled_particles = m_game.emitter.culled_count();
+}
+
+const Map::RenderStats& Map::render_stats() const
+{
+    return m_render_stats;
+}
+
+void Map::update_render_queue()
+{
+    // Entities are stamped twice per frame: once when found visible and once more when added
+    // to the queue so that entities coming into view can be told apart from queued ones.
+    m_render_frame += 2;
+
+    const auto visible = m_render_frame;
+    const auto queued  = m_render_frame + 1;
+
+    const SDL_Rect area = { m_camera.x - CULL_MARGIN, m_camera.y - CULL_MARGIN, m_camera.w + CULL_MARGIN * 2,
+                            m_camera.h + CULL_MARGIN * 2 };
+
+    m_spatial_grid.query_rect(area, m_query_buffer);
+
+    for (auto entity : m_query_buffer) {
+        if (const auto bounds = entity->render_bounds(); SDL_HasIntersection(&bounds, &m_camera)) {
+            entity->set_render_frame(visible);
+        }
+    }
+
+    // Drop the entities that went off-screen while keeping last frame's order.
+    size_t count = 0;
+
+    for (auto entity : m_render_queue) {
+        if (entity->render_frame() == visible) {
+            entity->set_render_frame(queued);
+            m_render_queue[count++] = entity;
+        }
+    }
+
+    m_render_queue.resize(count);
+
+    // Add the entities that came into view.
+    for (auto entity : m_query_buffer) {
+        if (entity->render_frame() == visible) {
+            entity->set_render_frame(queued);
+            m_render_queue.push_back(entity);
+        }
+    }
+
+    sort_render_queue();
+
+    m_render_stats.drawn_entities  = m_render_queue.size();
+    m_render_stats.culled_entities = m_entities.size() - m_render_queue.size();
+}
+
+void Map::sort_render_queue()
+{
+    // Most entities barely move between frames so last frame's order is almost sorted
+    // already. Insertion sort is close to linear in that case (unlike std::sort).
+    for (size_t i = 1; i < m_render_queue.size(); ++i) {
+        auto entity = m_render_queue[i];
+        auto y      = entity->pos_y();
+        auto j      = i;
+
+        while (j > 0 && m_render_queue[j - 1]->pos_y() > y) {
+            m_render_queue[j] = m_render_queue[j - 1];
+            --j;
+        }
+
+        m_render_queue[j] = entity;
+    }
 }
 
 void Map::render_minimap()
@@ -481,7 +869,13 @@ void Map::render_minimap()
     int      rx, ry;
     SDL_Rect pr;
 
-    for (auto& entity : m_entities) {
+    // The area of the map covered by the minimap (padded since the grid uses the entity center).
+    const SDL_Rect area = { m_camera.x - 20 * MINIMAP_SCALE, m_camera.y - 30 * MINIMAP_SCALE,
+                            60 * MINIMAP_SCALE + CHARACTER_WIDTH, 60 * MINIMAP_SCALE + CHARACTER_HEIGHT };
+
+    m_spatial_grid.query_rect(area, m_query_buffer);
+
+    for (auto& entity : m_query_buffer) {
         rx = m_game.window.width() - 90 + (entity->pos_x() - m_camera.x) / MINIMAP_SCALE;
         ry = 70 + (entity->pos_y() - m_camera.y) / MINIMAP_SCALE;
         pr = { rx, ry, MINIMAP_DOT_SIZE, MINIMAP_DOT_SIZE };
@@ -502,15 +896,6 @@ Map::~Map()
 {
     LOG_DEBUG << "Destroying map" << std::endl;
 
-    auto iter = m_entities.begin();
-
-    // Only remove the enemies (the player is not dynamically allocated).
-    while (iter != m_entities.end()) {
-        if (auto& entity = *iter; !entity->is_player()) {
-            delete *iter;
-            m_entities.erase(iter);
-        } else {
-            ++iter;
-        }
-    }
+    // The enemies are destroyed by the storage (the player is only attached).
+    m_entities.clear();
 }
@@ -8,13 +8,22 @@
 #include <SDL2/SDL.h>
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "characters/ai.h"
+#include "characters/animation.h"
+#include "characters/components.h"
 #include "characters/entity.h"
 #include "core/common.h"
+#include "core/slot_map.h"
 #include "graphics/texture.h"
+#include "maps/flow.h"
+#include "maps/pathfinder.h"
 #include "maps/search.h"
+#include "maps/separation.h"
+#include "maps/spatial.h"
 #include "maps/tile.h"
 
 class Game;
@@ -23,6 +32,25 @@ class Game;
 // and background/foreground tiles.
 class Map
 {
+public:
+    // Counters from the last rendered frame.
+    struct RenderStats
+    {
+        int drawn_entities;
+        int culled_entities;
+        int drawn_particles;
+        int culled_particles;
+    };
+
+    // Counters from the last update.
+    struct SimulationStats
+    {
+        int full_detail;
+        int reduced_detail;
+        int dormant;
+        int updated;
+    };
+
 public:
     // Create a new map for the game.
     explicit Map(Game& game, Entity& player);
@@ -43,6 +71,10 @@ public:
     // Return the tile at the given position.
     Tile& at(int row, int col);
 
+    // Clear the foreground of the tile at the given position (ex. picked up items or opened doors)
+    // and update the search graph.
+    void clear_fg(int row, int col);
+
     // X camera offset.
     int camera_offset_x(int x) const;
 
@@ -50,20 +82,91 @@ public:
     int camera_offset_y(int y) const;
 
     // Return all entities on the map.
-    std::vector<Entity*>& entities();
+    const std::vector<Entity*>& entities() const;
+
+    // Return the entity referred to by the handle or nullptr if it no longer exists.
+    Entity* entity(Handle handle) const;
+
+    // Create a new entity of an archetype at the given position. Returns an invalid handle on failure.
+    Handle spawn(Entity::Type type, int archetype, int x, int y);
+
+    // Remove an entity from the map (the player cannot be removed).
+    void despawn(Handle handle);
+
+    // Return the component arrays of the entities.
+    Components& components();
+
+    // Return the AI of the enemies.
+    AI& ai();
+
+    // Return the queue of the events fired by the animations.
+    AnimationEvents& animation_events();
+
+    // Return the path search graph of the map.
+    SearchGraph& search_graph();
+
+    // Return the background path search service.
+    Pathfinder& pathfinder();
+
+    // Return the flow field leading to the player.
+    const FlowField& flow_field() const;
+
+    // Return the spatial index of all entities on the map.
+    const SpatialGrid& spatial_grid() const;
+
+    // Return the pass that keeps the entities from overlapping.
+    Separation& separation();
+
+    // Return true if nothing blocks the straight line between two points on the map (in pixels).
+    bool line_of_sight(float x0, float y0, float x1, float y1) const;
+
+    // Test the line of sight from one point to the center of every entity (the result of each
+    // entity is stored at the same index of visible).
+    void line_of_sight(float x, float y, const std::vector<Entity*>& entities, std::vector<uint8_t>& visible) const;
+
+    // Cast a ray between two points on the map (in pixels). Returns true if it hits a blocked tile,
+    // in which case the end point is moved to where the ray enters the tile.
+    bool raycast(float x0, float y0, float& x1, float& y1) const;
+
+    // Update the entities and keep the spatial index in sync with their new positions. Only the
+    // entities near the player (or on screen) are updated every frame, the ones further away are
+    // updated every few frames over the time they missed and the ones far away are left alone.
+    void update(uint32_t ticks);
+
+    // Keep an entity at full detail for a while whatever its distance to the player (ex. when hit).
+    void wake(Entity* entity);
+
+    // Return true if the entity was drawn on the last rendered frame.
+    bool on_screen(const Entity* entity) const;
+
+    // Return the counters of simulated entities from the last update.
+    const SimulationStats& simulation_stats() const;
 
     // Render the minimap which is a scaled down version of the map with only entities visible.
     void render_minimap();
 
-    // Go to the next map level.
+    // Go to the next map level (after the current update).
     void go_to_next_level();
 
-    // Go to the previous map level.
+    // Go to the previous map level (after the current update).
     void go_to_prev_level();
 
     // Render the map and entities.
     void render();
 
+    // Return the counters of drawn and culled items from the last render.
+    const RenderStats& render_stats() const;
+
+private:
+    // Return the level of detail an entity is simulated at.
+    Components::Tier detail_tier(const Entity* entity, uint32_t now) const;
+
+    // Find the entities visible through the camera and update the render queue.
+    void update_render_queue();
+
+    // Restore the back-to-front (by y position) order of the render queue.
+    void sort_render_queue();
+
 private:
     int m_level;
 
@@ -74,11 +177,34 @@ private:
     Texture m_minimap_texture;
     Texture m_flashlight_texture;
 
-    SDL_Rect             m_camera;
-    std::vector<Entity*> m_entities;
+    SDL_Rect m_camera;
+
+    // Declared before the entities, which give their slots back when destroyed.
+    Components      m_components;
+    SlotMap<Entity> m_entities;
+    AI              m_ai;
+    AnimationEvents m_animation_events;
+
+    std::optional<int> m_next_level;
 
     SDL_Rect m_clips[MAP_TILE_SPRITESHEET_SIZE];
     Tile     m_tiles[MAP_TILE_COL_COUNT * MAP_TILE_ROW_COUNT];
 
     SearchGraph m_search_graph;
+    Pathfinder  m_pathfinder;
+    FlowField   m_flow_field;
+    SpatialGrid m_spatial_grid;
+    Separation  m_separation;
+
+    std::vector<Entity*> m_query_buffer;
+    std::vector<Entity*> m_moved_buffer;
+
+    uint32_t        m_update_frame;
+    SimulationStats m_simulation_stats;
+
+    // The visible entities in the order they are drawn. This is kept separate from m_entities so
+    // that sorting for rendering never changes the order in which entities are simulated.
+    std::vector<Entity*> m_render_queue;
+    uint32_t             m_render_frame;
+    RenderStats          m_render_stats;
 };
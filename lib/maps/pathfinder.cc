@@ -0,0 +1,317 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "maps/pathfinder.h"
+
+#include <algorithm>
+#include <limits>
+
+bool Pathfinder::Ticket::done() const
+{
+    return m_state.load(std::memory_order_acquire) != PENDING;
+}
+
+bool Pathfinder::Ticket::cancelled() const
+{
+    return m_state.load(std::memory_order_acquire) == CANCELLED;
+}
+
+bool Pathfinder::Ticket::found() const
+{
+    return m_found;
+}
+
+const std::vector<Pathfinder::Cell>& Pathfinder::Ticket::path() const
+{
+    return m_path;
+}
+
+Pathfinder::Pathfinder(int rows, int columns, int agent_size)
+  : m_current_cancelled(false)
+  , m_current_started(false)
+  , m_frame_budget(DEFAULT_FRAME_BUDGET)
+  , m_budget(0)
+  , m_stop(false)
+  , m_stats()
+  , m_graph(rows, columns)
+  , m_cache(rows, columns)
+{
+    m_graph.set_agent_size(agent_size);
+
+    m_thread = std::thread(&Pathfinder::run, this);
+}
+
+Pathfinder::~Pathfinder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_stop = true;
+    }
+
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void Pathfinder::load(const CollisionGrid& collision)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_snapshot = collision;
+    m_changes.clear();
+}
+
+void Pathfinder::set_blocked(Cell cell, bool blocked)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_changes.push_back({ cell, blocked });
+}
+
+std::shared_ptr<const Pathfinder::Ticket> Pathfinder::request(Handle owner, Cell src, Cell dest,
+                                                               SearchGraph::Algorithm algorithm)
+{
+    auto ticket = std::make_shared<Ticket>();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        ++m_stats.requests;
+
+        // The search in progress for the owner is out of date now.
+        if (m_current.has_value() && m_current->owner == owner && !m_current_cancelled) {
+            cancel_ticket(*m_current->ticket);
+            m_current_cancelled = true;
+            ++m_stats.coalesced;
+        }
+
+        // A request still waiting in the queue is replaced in place (keeping its turn).
+        const auto pending = std::find_if(m_queue.begin(), m_queue.end(),
+                                          [&owner](const Request& request) { return request.owner == owner; });
+
+        if (pending != m_queue.end()) {
+            cancel_ticket(*pending->ticket);
+            *pending = { owner, src, dest, algorithm, ticket };
+            ++m_stats.coalesced;
+        } else {
+            m_queue.push_back({ owner, src, dest, algorithm, ticket });
+        }
+    }
+
+    m_wake.notify_one();
+
+    return ticket;
+}
+
+void Pathfinder::cancel(Handle owner)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_current.has_value() && m_current->owner == owner && !m_current_cancelled) {
+        cancel_ticket(*m_current->ticket);
+        m_current_cancelled = true;
+    }
+
+    for (auto iter = m_queue.begin(); iter != m_queue.end();) {
+        if (iter->owner == owner) {
+            cancel_ticket(*iter->ticket);
+            iter = m_queue.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+void Pathfinder::cancel_all()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_current.has_value() && !m_current_cancelled) {
+        cancel_ticket(*m_current->ticket);
+        m_current_cancelled = true;
+    }
+
+    for (auto& request : m_queue) {
+        cancel_ticket(*request.ticket);
+    }
+
+    m_queue.clear();
+}
+
+void Pathfinder::begin_frame()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // The budget is not carried over, an idle frame does not allow a longer stall later.
+        m_budget = m_frame_budget > 0 ? m_frame_budget : std::numeric_limits<int>::max();
+    }
+
+    m_wake.notify_one();
+}
+
+void Pathfinder::set_cache_region_size(int region_size)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_cache_region_size = region_size;
+    }
+
+    m_wake.notify_one();
+}
+
+void Pathfinder::set_frame_budget(int budget)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_frame_budget = budget;
+}
+
+int Pathfinder::frame_budget() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_frame_budget;
+}
+
+int Pathfinder::pending() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_queue.size() + (m_current.has_value() ? 1 : 0);
+}
+
+Pathfinder::Stats Pathfinder::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_stats;
+}
+
+void Pathfinder::cancel_ticket(Ticket& ticket)
+{
+    ticket.m_state.store(Ticket::CANCELLED, std::memory_order_release);
+}
+
+void Pathfinder::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_wake.wait(lock, [this] {
+            return m_stop || m_snapshot.has_value() || !m_changes.empty() || m_cache_region_size.has_value()
+                   || ((m_current.has_value() || !m_queue.empty()) && m_budget > 0);
+        });
+
+        if (m_stop) {
+            return;
+        }
+
+        // Apply the changes to the walls (a search in progress has to start over).
+        if (m_snapshot.has_value() || !m_changes.empty()) {
+            if (m_snapshot.has_value()) {
+                m_graph.assign(*m_snapshot);
+                m_snapshot.reset();
+                m_cache.clear();
+            }
+
+            const auto size = m_graph.agent_size();
+
+            for (const auto& [cell, blocked] : m_changes) {
+                if (m_graph.blocked(cell) == blocked) {
+                    continue;
+                }
+
+                m_graph.set_blocked(cell, blocked);
+
+                // Paths through any cell whose square of tiles covers the tile are affected.
+                for (int row = cell.row - size + 1; row <= cell.row; ++row) {
+                    for (int col = cell.column - size + 1; col <= cell.column; ++col) {
+                        m_cache.invalidate({ row, col });
+                    }
+                }
+            }
+
+            m_changes.clear();
+            m_current_started = false;
+            m_stats.cache     = m_cache.stats();
+
+            continue;
+        }
+
+        if (m_cache_region_size.has_value()) {
+            m_cache.set_region_size(*m_cache_region_size);
+            m_cache_region_size.reset();
+            m_stats.cache = m_cache.stats();
+
+            continue;
+        }
+
+        if (!m_current.has_value()) {
+            m_current = std::move(m_queue.front());
+            m_queue.pop_front();
+
+            m_current_cancelled = false;
+            m_current_started   = false;
+        }
+
+        const auto request = *m_current;
+        const auto started = m_current_started;
+        const auto slice   = std::min(m_budget, SLICE_SIZE);
+
+        m_current_started = true;
+
+        // Search without holding the lock so that requests can be made in the meantime.
+        lock.unlock();
+
+        // Nothing else touches the ticket until it is marked as done.
+        auto status = SearchGraph::SEARCHING;
+        auto used   = 0;
+
+        if (!started && m_cache.find(m_graph, request.src, request.dest, request.ticket->m_path)) {
+            status                  = SearchGraph::FOUND;
+            used                    = m_cache.nodes_expanded();
+            request.ticket->m_found = true;
+        } else {
+            if (!started) {
+                used = m_cache.nodes_expanded();
+
+                m_graph.start_search(request.src, request.dest, request.algorithm);
+            }
+
+            // Hierarchical searches are done in start_search() so count everything since the start.
+            const auto expanded = started ? m_graph.nodes_expanded() : 0;
+
+            status = m_graph.continue_search(slice);
+            used += m_graph.nodes_expanded() - expanded;
+
+            if (status != SearchGraph::SEARCHING) {
+                m_graph.search_path(request.ticket->m_path);
+                request.ticket->m_found = status == SearchGraph::FOUND;
+            }
+
+            if (status == SearchGraph::FOUND) {
+                m_cache.insert(request.src, request.dest, request.ticket->m_path);
+            }
+        }
+
+        lock.lock();
+
+        m_stats.cache = m_cache.stats();
+
+        m_budget -= std::min(m_budget, std::max(used, 1));
+        m_stats.nodes_expanded += used;
+
+        if (m_current_cancelled) {
+            m_current.reset();
+        } else if (status != SearchGraph::SEARCHING) {
+            request.ticket->m_state.store(Ticket::DONE, std::memory_order_release);
+            ++m_stats.completed;
+
+            m_current.reset();
+        }
+    }
+}
@@ -0,0 +1,169 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "core/slot_map.h"
+#include "maps/cache.h"
+#include "maps/collision.h"
+#include "maps/search.h"
+
+// Pathfinder searches for paths on a worker thread so that many entities searching at once
+// do not stall the frame. The worker has its own copy of the collision grid and expands at
+// most a fixed number of nodes per frame; long searches simply continue on the next frame.
+//
+// Found paths are kept in a PathCache so that requests between the same regions (ex. enemies
+// leaving the same room) are mostly answered without a full search.
+//
+// Each request returns a ticket that is polled until it is done. An owner only ever has one
+// request: asking again replaces (and cancels) the previous one, so a target that keeps moving
+// never queues up stale searches.
+class Pathfinder
+{
+public:
+    using Cell = SearchGraph::Cell;
+
+    // The result of a request, shared by the requester and the worker thread.
+    class Ticket
+    {
+    public:
+        // Return true once the search has finished (or the request was cancelled).
+        bool done() const;
+
+        // Return true if the request was cancelled before it finished.
+        bool cancelled() const;
+
+        // Return true if the destination can be reached. Only valid once done (and not cancelled).
+        bool found() const;
+
+        // Return the path in the same format as SearchGraph::find_path(). Only valid once done (and not
+        // cancelled).
+        const std::vector<Cell>& path() const;
+
+    private:
+        friend class Pathfinder;
+
+        enum State
+        {
+            PENDING,
+            DONE,
+            CANCELLED,
+        };
+
+        std::atomic<int>  m_state = PENDING;
+        bool              m_found = false;
+        std::vector<Cell> m_path;
+    };
+
+    // Counters since the pathfinder was created.
+    struct Stats
+    {
+        int requests;
+        int coalesced;
+        int completed;
+        int nodes_expanded;
+
+        PathCache::Stats cache;
+    };
+
+    // The default number of nodes expanded per frame.
+    static const int DEFAULT_FRAME_BUDGET = 4000;
+
+public:
+    // Create a new pathfinder (and start its worker thread) for a grid of the given size. Paths
+    // are searched for agents of the given size (see SearchGraph::set_agent_size()).
+    explicit Pathfinder(int rows, int columns, int agent_size = 1);
+
+    // Pathfinder destructor. Stops the worker thread.
+    ~Pathfinder();
+
+public:
+    // Copy the whole collision grid (ex. after loading a level).
+    void load(const CollisionGrid& collision);
+
+    // Set whether a cell is blocked.
+    void set_blocked(Cell cell, bool blocked);
+
+    // Request a path for an owner, replacing any request the owner still has pending.
+    std::shared_ptr<const Ticket> request(Handle owner, Cell src, Cell dest,
+                                          SearchGraph::Algorithm algorithm = SearchGraph::A_STAR);
+
+    // Cancel the pending request of an owner.
+    void cancel(Handle owner);
+
+    // Cancel every pending request.
+    void cancel_all();
+
+    // Start a new frame, allowing the worker to expand up to the frame budget of nodes.
+    void begin_frame();
+
+    // Set the number of nodes expanded per frame (0 for unlimited).
+    void set_frame_budget(int budget);
+
+    // Return the number of nodes expanded per frame.
+    int frame_budget() const;
+
+    // Set the size of the path cache regions (drops the cached paths).
+    void set_cache_region_size(int region_size);
+
+    // Return the number of requests waiting (including the one being searched).
+    int pending() const;
+
+    // Return the counters.
+    Stats stats() const;
+
+private:
+    struct Request
+    {
+        Handle                  owner;
+        Cell                    src;
+        Cell                    dest;
+        SearchGraph::Algorithm  algorithm;
+        std::shared_ptr<Ticket> ticket;
+    };
+
+    // The number of nodes expanded between checks for cancelled requests.
+    static constexpr int SLICE_SIZE = 256;
+
+    // Mark a ticket as cancelled (must hold the lock).
+    static void cancel_ticket(Ticket& ticket);
+
+    // The worker thread loop.
+    void run();
+
+private:
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_wake;
+
+    std::deque<Request>    m_queue;
+    std::optional<Request> m_current;
+    bool                   m_current_cancelled;
+    bool                   m_current_started;
+
+    // Changes to the collision grid waiting to be applied by the worker.
+    std::optional<CollisionGrid>       m_snapshot;
+    std::vector<std::pair<Cell, bool>> m_changes;
+    std::optional<int>                 m_cache_region_size;
+
+    int   m_frame_budget;
+    int   m_budget;
+    bool  m_stop;
+    Stats m_stats;
+
+    // Only used by the worker thread.
+    SearchGraph m_graph;
+    PathCache   m_cache;
+
+    std::thread m_thread;
+};
@@ -0,0 +1,402 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "maps/planner.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+// The cost of nodes that cannot be reached (yet).
+static const uint32_t INFINITE = std::numeric_limits<uint32_t>::max();
+
+// Node heap positions for nodes that are not in the open list.
+static const int32_t UNTOUCHED = -2;
+static const int32_t NOT_QUEUED = -1;
+
+// The neighbors of a cell.
+static const int NEIGHBOR_OFFSETS[8][2] = {
+    { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 }, { -1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 },
+};
+
+// Octile distance between two cells.
+static uint32_t heuristic(SearchGraph::Cell a, SearchGraph::Cell b)
+{
+    const uint32_t dr = std::abs(a.row - b.row);
+    const uint32_t dc = std::abs(a.column - b.column);
+
+    return SearchGraph::STRAIGHT_COST * std::max(dr, dc)
+           + (SearchGraph::DIAGONAL_COST - SearchGraph::STRAIGHT_COST) * std::min(dr, dc);
+}
+
+Planner::Planner(const CollisionGrid& collision)
+  : m_collision(collision)
+  , m_initialized(false)
+  , m_src({ -1, -1 })
+  , m_dest({ -1, -1 })
+  , m_key_modifier(0)
+  , m_nodes_expanded(0)
+{
+    reset();
+}
+
+bool Planner::find_path(Cell src, Cell dest, std::vector<Cell>& path)
+{
+    path.clear();
+
+    m_nodes_expanded = 0;
+
+    // Already at destination, nothing to do...
+    if (src == dest) {
+        return true;
+    }
+
+    if (!m_collision.contains(src.row, src.column) || !m_collision.contains(dest.row, dest.column)) {
+        return false;
+    }
+
+    if (!m_initialized) {
+        initialize(src, dest);
+    } else {
+        // Every key in the open list is now at most this much too high (the heuristic is consistent).
+        if (!(dest == m_dest)) {
+            m_key_modifier += heuristic(m_dest, dest);
+            m_dest = dest;
+        }
+
+        // The old source has to be reached from its neighbors like any other node from now on.
+        if (!(src == m_src)) {
+            const auto old = m_src;
+
+            m_src = src;
+
+            update_node(index_of(src));
+            update_node(index_of(old));
+        }
+    }
+
+    compute_path();
+
+    const auto dest_index = index_of(m_dest);
+
+    if (m_nodes[dest_index].g != INFINITE) {
+        build_path(dest_index, path);
+        return true;
+    }
+
+    // The destination cannot be reached so head towards the closest cell instead.
+    auto closest          = index_of(m_src);
+    auto closest_distance = heuristic(m_src, m_dest);
+
+    for (auto index : m_touched) {
+        if (m_nodes[index].g == INFINITE) {
+            continue;
+        }
+
+        if (const auto distance = heuristic(cell_of(index), m_dest); distance < closest_distance) {
+            closest          = index;
+            closest_distance = distance;
+        }
+    }
+
+    build_path(closest, path);
+
+    return false;
+}
+
+void Planner::update(Cell cell)
+{
+    if (!m_initialized || !m_collision.contains(cell.row, cell.column)) {
+        return;
+    }
+
+    // The cell itself and every move to, from or around the corner of it.
+    update_node(index_of(cell));
+
+    for (const auto& [dr, dc] : NEIGHBOR_OFFSETS) {
+        if (m_collision.contains(cell.row + dr, cell.column + dc)) {
+            update_node(index_of({ cell.row + dr, cell.column + dc }));
+        }
+    }
+}
+
+void Planner::reset()
+{
+    if (const auto size = static_cast<size_t>(m_collision.rows() * m_collision.columns()); m_nodes.size() != size) {
+        m_nodes.assign(size, { INFINITE, INFINITE, { INFINITE, INFINITE }, UNTOUCHED });
+    } else {
+        for (auto index : m_touched) {
+            m_nodes[index] = { INFINITE, INFINITE, { INFINITE, INFINITE }, UNTOUCHED };
+        }
+    }
+
+    m_touched.clear();
+    m_heap.clear();
+
+    m_initialized  = false;
+    m_key_modifier = 0;
+}
+
+int Planner::nodes_expanded() const
+{
+    return m_nodes_expanded;
+}
+
+size_t Planner::memory_usage() const
+{
+    return m_nodes.capacity() * sizeof(Node) + (m_heap.capacity() + m_touched.capacity()) * sizeof(int);
+}
+
+uint32_t Planner::step_cost(Cell from, Cell to) const
+{
+    if (m_collision.blocked(to.row, to.column) || !m_collision.contains(from.row, from.column)) {
+        return INFINITE;
+    }
+
+    if (from.row == to.row || from.column == to.column) {
+        return SearchGraph::STRAIGHT_COST;
+    }
+
+    // Do not cut the corner of a blocked tile.
+    if (m_collision.blocked(from.row, to.column) || m_collision.blocked(to.row, from.column)) {
+        return INFINITE;
+    }
+
+    return SearchGraph::DIAGONAL_COST;
+}
+
+Planner::Key Planner::calculate_key(int index) const
+{
+    const auto cost = std::min(m_nodes[index].g, m_nodes[index].rhs);
+
+    if (cost == INFINITE) {
+        return { INFINITE, INFINITE };
+    }
+
+    return { cost + heuristic(cell_of(index), m_dest) + m_key_modifier, cost };
+}
+
+void Planner::update_node(int index)
+{
+    auto& node = m_nodes[index];
+
+    if (node.heap_index == UNTOUCHED) {
+        node.heap_index = NOT_QUEUED;
+        m_touched.push_back(index);
+    }
+
+    const auto cell = cell_of(index);
+
+    if (cell == m_src) {
+        node.rhs = 0;
+    } else {
+        // The cheapest way to get here from a neighbor.
+        node.rhs = INFINITE;
+
+        for (const auto& [dr, dc] : NEIGHBOR_OFFSETS) {
+            const Cell prev = { cell.row + dr, cell.column + dc };
+
+            if (!m_collision.contains(prev.row, prev.column)) {
+                continue;
+            }
+
+            if (const auto g = m_nodes[index_of(prev)].g; g != INFINITE) {
+                if (const auto cost = step_cost(prev, cell); cost != INFINITE) {
+                    node.rhs = std::min(node.rhs, g + cost);
+                }
+            }
+        }
+    }
+
+    // Only inconsistent nodes are queued.
+    if (node.g != node.rhs) {
+        node.key = calculate_key(index);
+
+        if (node.heap_index >= 0) {
+            heap_update(index);
+        } else {
+            heap_push(index);
+        }
+    } else if (node.heap_index >= 0) {
+        heap_remove(index);
+    }
+}
+
+void Planner::compute_path()
+{
+    const auto dest = index_of(m_dest);
+
+    while (!m_heap.empty()) {
+        const auto current = m_heap.front();
+
+        if (!(m_nodes[current].key < calculate_key(dest)) && m_nodes[dest].rhs == m_nodes[dest].g) {
+            break;
+        }
+
+        ++m_nodes_expanded;
+
+        auto& node = m_nodes[current];
+
+        // The key was calculated before the destination moved.
+        if (const auto key = calculate_key(current); node.key < key) {
+            node.key = key;
+            heap_update(current);
+            continue;
+        }
+
+        const auto cell = cell_of(current);
+
+        if (node.g > node.rhs) {
+            // Found a cheaper way here.
+            node.g = node.rhs;
+            heap_remove(current);
+        } else {
+            // The node got more expensive, so everything reached through it has to be checked.
+            node.g = INFINITE;
+            update_node(current);
+        }
+
+        for (const auto& [dr, dc] : NEIGHBOR_OFFSETS) {
+            if (m_collision.contains(cell.row + dr, cell.column + dc)) {
+                update_node(index_of({ cell.row + dr, cell.column + dc }));
+            }
+        }
+    }
+}
+
+void Planner::initialize(Cell src, Cell dest)
+{
+    reset();
+
+    m_src         = src;
+    m_dest        = dest;
+    m_initialized = true;
+
+    update_node(index_of(src));
+}
+
+void Planner::build_path(int index, std::vector<Cell>& path) const
+{
+    const auto src = index_of(m_src);
+
+    // The source is not part of the path. Every step goes to a cheaper node so the number of
+    // steps is bounded anyway, the limit only guards against an inconsistent tree.
+    for (size_t steps = 0; index != src && steps < m_nodes.size(); ++steps) {
+        const auto cell = cell_of(index);
+
+        path.push_back(cell);
+
+        auto best      = -1;
+        auto best_cost = INFINITE;
+
+        for (const auto& [dr, dc] : NEIGHBOR_OFFSETS) {
+            const Cell prev = { cell.row + dr, cell.column + dc };
+
+            if (!m_collision.contains(prev.row, prev.column)) {
+                continue;
+            }
+
+            const auto g    = m_nodes[index_of(prev)].g;
+            const auto cost = step_cost(prev, cell);
+
+            if (g != INFINITE && cost != INFINITE && g + cost < best_cost) {
+                best      = index_of(prev);
+                best_cost = g + cost;
+            }
+        }
+
+        if (best < 0) {
+            path.clear();
+            return;
+        }
+
+        index = best;
+    }
+
+    std::reverse(path.begin(), path.end());
+}
+
+void Planner::heap_push(int index)
+{
+    m_nodes[index].heap_index = m_heap.size();
+    m_heap.push_back(index);
+
+    heap_sift_up(m_heap.size() - 1);
+}
+
+void Planner::heap_remove(int index)
+{
+    const auto position = m_nodes[index].heap_index;
+    const auto last     = m_heap.back();
+
+    m_heap.pop_back();
+    m_nodes[index].heap_index = NOT_QUEUED;
+
+    if (last == index) {
+        return;
+    }
+
+    m_heap[position]         = last;
+    m_nodes[last].heap_index = position;
+
+    heap_update(last);
+}
+
+void Planner::heap_update(int index)
+{
+    heap_sift_up(m_nodes[index].heap_index);
+    heap_sift_down(m_nodes[index].heap_index);
+}
+
+void Planner::heap_sift_up(int position)
+{
+    const auto index = m_heap[position];
+
+    while (position > 0) {
+        const auto parent = (position - 1) / 2;
+
+        if (!(m_nodes[index].key < m_nodes[m_heap[parent]].key)) {
+            break;
+        }
+
+        m_heap[position]                     = m_heap[parent];
+        m_nodes[m_heap[position]].heap_index = position;
+
+        position = parent;
+    }
+
+    m_heap[position]          = index;
+    m_nodes[index].heap_index = position;
+}
+
+void Planner::heap_sift_down(int position)
+{
+    const auto index = m_heap[position];
+    const auto size  = static_cast<int>(m_heap.size());
+
+    while (true) {
+        auto child = position * 2 + 1;
+
+        if (child >= size) {
+            break;
+        }
+
+        if (child + 1 < size && m_nodes[m_heap[child + 1]].key < m_nodes[m_heap[child]].key) {
+            ++child;
+        }
+
+        if (!(m_nodes[m_heap[child]].key < m_nodes[index].key)) {
+            break;
+        }
+
+        m_heap[position]                     = m_heap[child];
+        m_nodes[m_heap[position]].heap_index = position;
+
+        position = child;
+    }
+
+    m_heap[position]          = index;
+    m_nodes[index].heap_index = position;
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "maps/collision.h"
+#include "maps/search.h"
+
+// Planner is an incremental path planner for long-lived searches (ex. chasing a target for
+// a long time while walls open and close). Instead of searching from scratch every time the
+// source, the destination or the walls change, the search tree of the previous query is kept
+// and only the part affected by the change is repaired.
+//
+// This is Lifelong Planning A* rooted at the source. Moving the destination only changes the
+// heuristic, which is handled by growing a key modifier (as D* Lite does for a moving start)
+// instead of reordering the open list. Moving the source and changing walls update the
+// affected nodes. Costs and heuristic are the same as SearchGraph so the paths are as short.
+//
+// Each planner keeps state for every tile of the grid, so it is meant for a few long-lived
+// searches rather than one per entity.
+//
+// See: http://idm-lab.org/bib/abstracts/papers/aij04.pdf
+class Planner
+{
+public:
+    using Cell = SearchGraph::Cell;
+
+public:
+    // Create a new planner over a collision grid.
+    explicit Planner(const CollisionGrid& collision);
+
+public:
+    // Find the shortest path from source to destination (in the same format as SearchGraph::find_path()),
+    // reusing the previous search. Call update() for every cell that has changed since the last query.
+    bool find_path(Cell src, Cell dest, std::vector<Cell>& path);
+
+    // Tell the planner that a cell was blocked or unblocked.
+    void update(Cell cell);
+
+    // Forget the previous search (the next query searches from scratch).
+    void reset();
+
+    // Return the number of nodes expanded by the last query.
+    int nodes_expanded() const;
+
+    // Return the number of bytes allocated by the planner.
+    size_t memory_usage() const;
+
+private:
+    struct Key
+    {
+        uint32_t primary;
+        uint32_t secondary;
+
+        bool operator<(const Key& other) const
+        {
+            return primary < other.primary || (primary == other.primary && secondary < other.secondary);
+        }
+    };
+
+    struct Node
+    {
+        uint32_t g;
+        uint32_t rhs;
+        Key      key;
+        int32_t  heap_index;
+    };
+
+    // Return the index of a cell in the node array.
+    int index_of(Cell cell) const
+    {
+        return cell.row * m_collision.columns() + cell.column;
+    }
+
+    // Return the cell of an index in the node array.
+    Cell cell_of(int index) const
+    {
+        return { index / m_collision.columns(), index % m_collision.columns() };
+    }
+
+    // Return the cost of moving between two neighboring cells (UINT32_MAX if it is not possible).
+    uint32_t step_cost(Cell from, Cell to) const;
+
+    // Return the key of a node.
+    Key calculate_key(int index) const;
+
+    // Recalculate the cost of reaching a node from its neighbors and queue it if it is inconsistent.
+    void update_node(int index);
+
+    // Expand nodes until the path to the destination is known.
+    void compute_path();
+
+    // Start a new search from source to destination.
+    void initialize(Cell src, Cell dest);
+
+    // Follow the cheapest neighbors back from a node to the source.
+    void build_path(int index, std::vector<Cell>& path) const;
+
+    // Binary heap (ordered by key) over node indices.
+    void heap_push(int index);
+    void heap_remove(int index);
+    void heap_update(int index);
+    void heap_sift_up(int position);
+    void heap_sift_down(int position);
+
+private:
+    const CollisionGrid& m_collision;
+
+    std::vector<Node> m_nodes;
+    std::vector<int>  m_heap;
+
+    // The nodes changed since the last reset.
+    std::vector<int> m_touched;
+
+    bool     m_initialized;
+    Cell     m_src;
+    Cell     m_dest;
+    uint32_t m_key_modifier;
+    int      m_nodes_expanded;
+};
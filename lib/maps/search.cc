@@ -5,38 +5,746 @@
 
 #include "maps/search.h"
 
-#include <queue>
-#include <unordered_map>
+#include <algorithm>
+#include <limits>
+
+#include "maps/hierarchy.h"
+
+// Node heap positions for nodes that are not in the open set.
+static const int32_t UNVISITED = -2;
+static const int32_t CLOSED    = -1;
+
+// The neighbors of a cell (the first four are the straight moves).
+static const int NEIGHBOR_OFFSETS[8][2] = {
+    { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 }, { -1, -1 }, { -1, 1 }, { 1, -1 }, { 1, 1 },
+};
 
 SearchGraph::SearchGraph(Tile (&tiles)[MAP_TILE_COL_COUNT * MAP_TILE_ROW_COUNT])
-  : m_map_tiles(tiles)
+  : SearchGraph(MAP_TILE_ROW_COUNT, MAP_TILE_COL_COUNT)
 {
-    (void)m_map_tiles;
+    m_map_tiles = tiles;
 }
 
-void SearchGraph::find_path(Cell src, Cell dest, std::vector<Cell>& path)
+SearchGraph::SearchGraph(int rows, int columns)
+  : m_map_tiles(nullptr)
+  , m_collision(rows, columns)
+  , m_clearance(rows, columns)
+  , m_agent_size(1)
+  , m_agent_collision(rows, columns)
+  , m_transposed(columns, rows)
+  , m_hierarchy(std::make_unique<SearchHierarchy>(m_agent_collision))
+  , m_query()
+  , m_nodes(rows * columns)
+  , m_generation(0)
+  , m_expansion_budget(0)
+  , m_nodes_expanded(0)
 {
-    // Reset our directions...
-    if (!path.empty()) {
-        path.clear();
+    m_heap.reserve(rows * columns);
+    m_clearance.rebuild(m_collision);
+}
+
+SearchGraph::~SearchGraph()
+{
+}
+
+void SearchGraph::rebuild()
+{
+    if (m_map_tiles == nullptr) {
+        return;
+    }
+
+    for (int row = 0; row < MAP_TILE_ROW_COUNT; ++row) {
+        for (int col = 0; col < MAP_TILE_COL_COUNT; ++col) {
+            m_collision.set_blocked(row, col, m_map_tiles[row + (col * MAP_TILE_ROW_COUNT)].is_solid());
+        }
+    }
+
+    // Computing the clearance once is cheaper than carrying every tile change up and to the left.
+    m_clearance.rebuild(m_collision);
+    update_agent_grid();
+
+    // Build the changed clusters now rather than on the first query.
+    m_hierarchy->update();
+}
+
+void SearchGraph::update(Cell cell)
+{
+    if (m_map_tiles == nullptr || !m_collision.contains(cell.row, cell.column)) {
+        return;
+    }
+
+    set_blocked(cell, m_map_tiles[cell.row + (cell.column * MAP_TILE_ROW_COUNT)].is_solid());
+}
+
+void SearchGraph::assign(const CollisionGrid& collision)
+{
+    for (int row = 0; row < m_collision.rows(); ++row) {
+        for (int col = 0; col < m_collision.columns(); ++col) {
+            m_collision.set_blocked(row, col, collision.blocked(row, col));
+        }
+    }
+
+    m_clearance.rebuild(m_collision);
+    update_agent_grid();
+
+    m_hierarchy->update();
+}
+
+void SearchGraph::set_blocked(Cell cell, bool blocked)
+{
+    if (!m_collision.contains(cell.row, cell.column) || m_collision.blocked(cell.row, cell.column) == blocked) {
+        return;
+    }
+
+    m_collision.set_blocked(cell.row, cell.column, blocked);
+    m_clearance.update(m_collision, cell.row, cell.column);
+
+    update_agent_cells(cell);
+}
+
+bool SearchGraph::blocked(Cell cell) const
+{
+    return m_collision.blocked(cell.row, cell.column);
+}
+
+const CollisionGrid& SearchGraph::collision() const
+{
+    return m_collision;
+}
+
+const CollisionGrid& SearchGraph::agent_collision() const
+{
+    return m_agent_collision;
+}
+
+const ClearanceMap& SearchGraph::clearance() const
+{
+    return m_clearance;
+}
+
+void SearchGraph::set_agent_size(int size)
+{
+    size = std::clamp(size, 1, ClearanceMap::MAX_CLEARANCE);
+
+    if (size == m_agent_size) {
+        return;
     }
 
+    m_agent_size = size;
+
+    update_agent_grid();
+}
+
+int SearchGraph::agent_size() const
+{
+    return m_agent_size;
+}
+
+void SearchGraph::set_agent_blocked(Cell cell, bool blocked)
+{
+    if (m_agent_collision.blocked(cell.row, cell.column) == blocked) {
+        return;
+    }
+
+    m_hierarchy->invalidate(cell);
+
+    m_agent_collision.set_blocked(cell.row, cell.column, blocked);
+    m_transposed.set_blocked(cell.column, cell.row, blocked);
+}
+
+void SearchGraph::update_agent_cells(Cell tile)
+{
+    // Only the cells up to the agent size above and to the left have the tile in their square.
+    for (int row = std::max(0, tile.row - m_agent_size + 1); row <= tile.row; ++row) {
+        for (int col = std::max(0, tile.column - m_agent_size + 1); col <= tile.column; ++col) {
+            set_agent_blocked({ row, col }, m_clearance.clearance(row, col) < m_agent_size);
+        }
+    }
+}
+
+void SearchGraph::update_agent_grid()
+{
+    for (int row = 0; row < m_collision.rows(); ++row) {
+        for (int col = 0; col < m_collision.columns(); ++col) {
+            set_agent_blocked({ row, col }, m_clearance.clearance(row, col) < m_agent_size);
+        }
+    }
+}
+
+void SearchGraph::set_expansion_budget(int budget)
+{
+    m_expansion_budget = budget;
+}
+
+int SearchGraph::expansion_budget() const
+{
+    return m_expansion_budget;
+}
+
+int SearchGraph::nodes_expanded() const
+{
+    return m_nodes_expanded;
+}
+
+size_t SearchGraph::memory_usage(Algorithm algorithm) const
+{
+    auto bytes = m_collision.memory_usage() + m_clearance.memory_usage() + m_agent_collision.memory_usage()
+                 + m_transposed.memory_usage() + m_nodes.capacity() * sizeof(Node) + m_heap.capacity() * sizeof(int);
+
+    if (algorithm == HIERARCHICAL) {
+        bytes += m_hierarchy->memory_usage() + m_hierarchy_path.capacity() * sizeof(Cell);
+    }
+
+    return bytes;
+}
+
+SearchGraph::Node& SearchGraph::node(int index)
+{
+    auto& record = m_nodes[index];
+
+    if (record.generation != m_generation) {
+        record.generation = m_generation;
+        record.cost       = std::numeric_limits<uint32_t>::max();
+        record.score      = std::numeric_limits<uint32_t>::max();
+        record.prev       = -1;
+        record.heap_index = UNVISITED;
+    }
+
+    return record;
+}
+
+bool SearchGraph::find_path(Cell src, Cell dest, std::vector<Cell>& path, Algorithm algorithm)
+{
+    start_search(src, dest, algorithm);
+
+    const auto status = continue_search(m_expansion_budget);
+
+    search_path(path);
+
+    return status == FOUND;
+}
+
+void SearchGraph::start_search(Cell src, Cell dest, Algorithm algorithm)
+{
+    m_query.src       = src;
+    m_query.dest      = dest;
+    m_query.algorithm = algorithm;
+    m_query.closest   = -1;
+
+    m_nodes_expanded = 0;
+
+    m_hierarchy_path.clear();
+
     // Already at destination, nothing to do...
-    if (src.column == dest.column && src.row == dest.row) {
+    if (src == dest) {
+        m_query.status = FOUND;
         return;
     }
 
-    std::priority_queue<Node> open_set;
-    std::vector<Node>         came_from;
+    if (!m_collision.contains(src.row, src.column) || !m_collision.contains(dest.row, dest.column)) {
+        m_query.status = NOT_FOUND;
+        return;
+    }
+
+    if (algorithm == HIERARCHICAL) {
+        const auto found = m_hierarchy->find_path(src, dest, m_hierarchy_path);
+
+        m_nodes_expanded = m_hierarchy->nodes_expanded();
+
+        if (found) {
+            m_query.status = FOUND;
+            return;
+        }
+
+        // Let A* find the closest reachable cell instead.
+        m_query.algorithm = A_STAR;
+    }
+
+    // A blocked destination is never reached and the jump points only visit a few of the cells
+    // around it, so A* finds the closest reachable cell instead.
+    if (algorithm == JUMP_POINT && m_agent_collision.blocked(dest.row, dest.column)) {
+        m_query.algorithm = A_STAR;
+    }
+
+    // Start a new generation; records from earlier queries become unvisited. When the
+    // counter wraps around the records have to be cleared for real.
+    if (++m_generation == 0) {
+        for (auto& record : m_nodes) {
+            record.generation = 0;
+        }
+
+        m_generation = 1;
+    }
+
+    m_heap.clear();
+
+    const auto src_index = index_of(src);
+
+    auto& start = node(src_index);
+    start.cost  = 0;
+    start.score = calculate_cost(src, dest);
+
+    heap_push(src_index);
+
+    m_query.status           = SEARCHING;
+    m_query.closest          = src_index;
+    m_query.closest_distance = start.score;
+}
 
-    std::unordered_map<Cell*, int> g_score = { { &src, 0 } };
-    std::unordered_map<Cell*, int> f_score = { { &src, calculate_cost(src, dest) } };
+SearchGraph::Status SearchGraph::continue_search(int budget)
+{
+    if (m_query.status != SEARCHING) {
+        return m_query.status;
+    }
+
+    const auto dest_index = index_of(m_query.dest);
+
+    for (int expanded = 0; !m_heap.empty(); ++expanded) {
+        if (budget > 0 && expanded >= budget) {
+            return SEARCHING;
+        }
+
+        const auto current = heap_pop();
+
+        if (current == dest_index) {
+            m_query.status = FOUND;
+            return FOUND;
+        }
+
+        ++m_nodes_expanded;
+
+        if (const auto distance = m_nodes[current].score - m_nodes[current].cost;
+            distance < m_query.closest_distance) {
+            m_query.closest          = current;
+            m_query.closest_distance = distance;
+        }
+
+        if (m_query.algorithm == JUMP_POINT) {
+            expand_jump_points(current, m_query.dest);
+        } else {
+            expand_neighbors(current, m_query.dest);
+        }
+    }
+
+    m_query.status = NOT_FOUND;
+
+    return NOT_FOUND;
+}
+
+void SearchGraph::search_path(std::vector<Cell>& path) const
+{
+    // Reset our directions...
+    path.clear();
+
+    if (m_query.status == FOUND && m_query.closest < 0) {
+        path = m_hierarchy_path;
+    } else if (m_query.status == FOUND) {
+        build_path(index_of(m_query.dest), path);
+    } else if (m_query.closest >= 0) {
+        // The destination is unreachable (or the search is not done yet) so head towards the closest cell.
+        build_path(m_query.closest, path);
+    }
+}
+
+void SearchGraph::smooth_path(Cell src, std::vector<Cell>& path) const
+{
+    if (path.size() < 2) {
+        return;
+    }
+
+    auto   anchor = src;
+    size_t kept   = 0;
+
+    // String pulling: keep going straight from the anchor until the next waypoint is out of sight.
+    for (size_t i = 0; i + 1 < path.size(); ++i) {
+        if (!m_agent_collision.line_of_sight(anchor.row, anchor.column, path[i + 1].row, path[i + 1].column)) {
+            anchor       = path[i];
+            path[kept++] = path[i];
+        }
+    }
+
+    path[kept++] = path.back();
+    path.resize(kept);
+}
+
+void SearchGraph::relax(int current, int next, uint32_t step, Cell dest)
+{
+    const auto next_cost = m_nodes[current].cost + step;
+
+    auto& record = node(next);
+
+    if (record.heap_index == CLOSED || next_cost >= record.cost) {
+        return;
+    }
+
+    record.prev = current;
+
+    if (record.heap_index == UNVISITED) {
+        record.cost  = next_cost;
+        record.score = next_cost + calculate_cost(cell_of(next), dest);
+
+        heap_push(next);
+    } else {
+        record.score -= record.cost - next_cost;
+        record.cost = next_cost;
+
+        heap_decrease(next);
+    }
+}
+
+void SearchGraph::expand_neighbors(int current, Cell dest)
+{
+    const auto cell = cell_of(current);
+
+    for (int i = 0; i < 8; ++i) {
+        const auto dr = NEIGHBOR_OFFSETS[i][0];
+        const auto dc = NEIGHBOR_OFFSETS[i][1];
+
+        if (m_agent_collision.blocked(cell.row + dr, cell.column + dc)) {
+            continue;
+        }
+
+        auto step = STRAIGHT_COST;
+
+        if (dr != 0 && dc != 0) {
+            // Do not cut the corner of a blocked tile.
+            if (m_agent_collision.blocked(cell.row + dr, cell.column)
+                || m_agent_collision.blocked(cell.row, cell.column + dc)) {
+                continue;
+            }
+
+            step = DIAGONAL_COST;
+        }
+
+        relax(current, index_of({ cell.row + dr, cell.column + dc }), step, dest);
+    }
+}
+
+// Scan a row of the collision grid from start in the direction (1 or -1) and return the
+// first jump point: a tile next to the end of an obstacle on either side (a path may have
+// to turn around it) or the goal (-1 when the goal is not on this row). Returns -1 if a
+// blocked tile (or the edge of the grid) is hit first.
+//
+// Whole words are tested at once: with U being the row above, a tile x is a jump point
+// when U[x] is free and U[x - direction] is blocked, which for all 64 tiles of a word is
+// ~U & (U shifted by one towards x). The same goes for the row below.
+static int jump_straight(const CollisionGrid& grid, int line, int start, int direction, int goal)
+{
+    const auto size = grid.columns();
+
+    if (line < 0 || line >= grid.rows() || start < 0 || start >= size) {
+        return -1;
+    }
+
+    const auto words = grid.words_per_row();
+    const auto row   = grid.row_data(line);
+    const auto above = line > 0 ? grid.row_data(line - 1) : nullptr;
+    const auto below = line + 1 < grid.rows() ? grid.row_data(line + 1) : nullptr;
+
+    // Rows outside of the grid are blocked.
+    const auto word_at = [words](const uint64_t* data, int w) -> uint64_t {
+        return data == nullptr || w < 0 || w >= words ? ~uint64_t(0) : data[w];
+    };
+
+    if (direction > 0) {
+        for (int w = start >> 6; w < words; ++w) {
+            const auto u = word_at(above, w);
+            const auto d = word_at(below, w);
+
+            // Shift the previous tile into place (carrying the last bit of the previous word).
+            const auto u_prev = (u << 1) | (word_at(above, w - 1) >> 63);
+            const auto d_prev = (d << 1) | (word_at(below, w - 1) >> 63);
+
+            auto stop = row[w] | (~u & u_prev) | (~d & d_prev);
+
+            // Everything past the last column is blocked.
+            if (w == words - 1 && (size & 63) != 0) {
+                stop |= ~uint64_t(0) << (size & 63);
+            }
+
+            if (w == start >> 6) {
+                stop &= ~uint64_t(0) << (start & 63);
+            }
+
+            if (stop != 0) {
+                const auto position = (w << 6) + __builtin_ctzll(stop);
+
+                // The goal is only reached if it is not the wall the scan stopped at.
+                if (goal >= start
+                    && (goal < position || (goal == position && position < size && !grid.blocked(line, position)))) {
+                    return goal;
+                }
+
+                return position >= size || grid.blocked(line, position) ? -1 : position;
+            }
+        }
+
+        return goal >= start ? goal : -1;
+    }
+
+    for (int w = start >> 6; w >= 0; --w) {
+        const auto u = word_at(above, w);
+        const auto d = word_at(below, w);
+
+        // Shift the next tile into place (carrying the first bit of the next word).
+        const auto u_next = (u >> 1) | (word_at(above, w + 1) << 63);
+        const auto d_next = (d >> 1) | (word_at(below, w + 1) << 63);
+
+        auto stop = row[w] | (~u & u_next) | (~d & d_next);
+
+        if (w == start >> 6 && (start & 63) != 63) {
+            stop &= (uint64_t(1) << ((start & 63) + 1)) - 1;
+        }
+
+        if (stop != 0) {
+            const auto position = (w << 6) + 63 - __builtin_clzll(stop);
+
+            // The goal is only reached if it is not the wall the scan stopped at.
+            if (goal >= 0 && goal <= start
+                && (goal > position || (goal == position && !grid.blocked(line, position)))) {
+                return goal;
+            }
+
+            return grid.blocked(line, position) ? -1 : position;
+        }
+    }
+
+    return goal >= 0 && goal <= start ? goal : -1;
+}
+
+int SearchGraph::jump(Cell cell, int dr, int dc, Cell dest) const
+{
+    if (dr == 0) {
+        const auto column = jump_straight(m_agent_collision, cell.row, cell.column, dc,
+                                          dest.row == cell.row ? dest.column : -1);
+
+        return column < 0 ? -1 : index_of({ cell.row, column });
+    }
+
+    if (dc == 0) {
+        // Columns are the rows of the transposed grid.
+        const auto row = jump_straight(m_transposed, cell.column, cell.row, dr,
+                                       dest.column == cell.column ? dest.row : -1);
+
+        return row < 0 ? -1 : index_of({ row, cell.column });
+    }
+
+    // Move diagonally until one of the straight jumps from the cell finds something.
+    while (!m_agent_collision.blocked(cell.row, cell.column)) {
+        if (cell == dest) {
+            return index_of(cell);
+        }
+
+        if (jump({ cell.row, cell.column + dc }, 0, dc, dest) >= 0
+            || jump({ cell.row + dr, cell.column }, dr, 0, dest) >= 0) {
+            return index_of(cell);
+        }
+
+        // Do not cut the corner of a blocked tile.
+        if (m_agent_collision.blocked(cell.row, cell.column + dc)
+            || m_agent_collision.blocked(cell.row + dr, cell.column)) {
+            return -1;
+        }
+
+        cell.row += dr;
+        cell.column += dc;
+    }
+
+    return -1;
+}
+
+void SearchGraph::expand_jump_points(int current, Cell dest)
+{
+    const auto cell = cell_of(current);
+    const auto prev = m_nodes[current].prev;
+
+    // The directions worth jumping in.
+    int directions[8][2];
+    int count = 0;
+
+    const auto free = [this, &cell](int dr, int dc) {
+        return !m_agent_collision.blocked(cell.row + dr, cell.column + dc);
+    };
+
+    const auto add = [&directions, &count](int dr, int dc) {
+        directions[count][0] = dr;
+        directions[count][1] = dc;
+        ++count;
+    };
+
+    if (prev < 0) {
+        // The source can go anywhere.
+        for (const auto& offset : NEIGHBOR_OFFSETS) {
+            add(offset[0], offset[1]);
+        }
+    } else {
+        // Only keep going in the direction we came from (plus the turns around obstacles).
+        const auto from = cell_of(prev);
+        const auto dr   = (cell.row > from.row) - (cell.row < from.row);
+        const auto dc   = (cell.column > from.column) - (cell.column < from.column);
+
+        if (dr != 0 && dc != 0) {
+            add(dr, 0);
+            add(0, dc);
+            add(dr, dc);
+        } else if (dr == 0) {
+            add(0, dc);
+
+            if (free(0, dc)) {
+                add(1, dc);
+                add(-1, dc);
+            }
+
+            add(1, 0);
+            add(-1, 0);
+        } else {
+            add(dr, 0);
+
+            if (free(dr, 0)) {
+                add(dr, 1);
+                add(dr, -1);
+            }
+
+            add(0, 1);
+            add(0, -1);
+        }
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const auto dr = directions[i][0];
+        const auto dc = directions[i][1];
+
+        if (!free(dr, dc)) {
+            continue;
+        }
+
+        // Do not cut the corner of a blocked tile.
+        if (dr != 0 && dc != 0 && (!free(dr, 0) || !free(0, dc))) {
+            continue;
+        }
+
+        if (const auto next = jump({ cell.row + dr, cell.column + dc }, dr, dc, dest); next >= 0) {
+            relax(current, next, calculate_cost(cell, cell_of(next)), dest);
+        }
+    }
 }
 
 uint32_t SearchGraph::calculate_cost(Cell src, Cell dest) const
 {
-    (void)src;
-    (void)dest;
+    const uint32_t dr = std::abs(src.row - dest.row);
+    const uint32_t dc = std::abs(src.column - dest.column);
+
+    // Move diagonally as far as possible, then straight.
+    return STRAIGHT_COST * std::max(dr, dc) + (DIAGONAL_COST - STRAIGHT_COST) * std::min(dr, dc);
+}
+
+void SearchGraph::build_path(int index, std::vector<Cell>& path) const
+{
+    // The source has no previous node and is not part of the path.
+    for (; m_nodes[index].prev >= 0; index = m_nodes[index].prev) {
+        const auto from = cell_of(m_nodes[index].prev);
+
+        auto cell = cell_of(index);
+
+        // Jump points are connected by straight or diagonal lines so fill in the cells between them.
+        const auto dr = (from.row > cell.row) - (from.row < cell.row);
+        const auto dc = (from.column > cell.column) - (from.column < cell.column);
+
+        while (!(cell == from)) {
+            path.push_back(cell);
+
+            cell.row += dr;
+            cell.column += dc;
+        }
+    }
+
+    std::reverse(path.begin(), path.end());
+}
+
+// Order by score, preferring the node farther from the source on ties (it is most
+// likely closer to the destination).
+static bool heap_less(const SearchGraph::Node& a, const SearchGraph::Node& b)
+{
+    return a.score < b.score || (a.score == b.score && a.cost > b.cost);
+}
+
+void SearchGraph::heap_push(int index)
+{
+    m_nodes[index].heap_index = m_heap.size();
+    m_heap.push_back(index);
+
+    heap_sift_up(m_heap.size() - 1);
+}
+
+int SearchGraph::heap_pop()
+{
+    const auto top = m_heap.front();
+
+    m_heap.front()                      = m_heap.back();
+    m_nodes[m_heap.front()].heap_index = 0;
+    m_heap.pop_back();
+
+    if (!m_heap.empty()) {
+        heap_sift_down(0);
+    }
+
+    m_nodes[top].heap_index = CLOSED;
+
+    return top;
+}
+
+void SearchGraph::heap_decrease(int index)
+{
+    heap_sift_up(m_nodes[index].heap_index);
+}
+
+void SearchGraph::heap_sift_up(int position)
+{
+    const auto index = m_heap[position];
+
+    while (position > 0) {
+        const auto parent = (position - 1) / 2;
+
+        if (!heap_less(m_nodes[index], m_nodes[m_heap[parent]])) {
+            break;
+        }
+
+        m_heap[position]                      = m_heap[parent];
+        m_nodes[m_heap[position]].heap_index = position;
+
+        position = parent;
+    }
+
+    m_heap[position]            = index;
+    m_nodes[index].heap_index = position;
+}
+
+void SearchGraph::heap_sift_down(int position)
+{
+    const auto index = m_heap[position];
+    const auto size  = static_cast<int>(m_heap.size());
+
+    while (true) {
+        auto child = position * 2 + 1;
+
+        if (child >= size) {
+            break;
+        }
+
+        if (child + 1 < size && heap_less(m_nodes[m_heap[child + 1]], m_nodes[m_heap[child]])) {
+            ++child;
+        }
+
+        if (!heap_less(m_nodes[m_heap[child]], m_nodes[index])) {
+            break;
+        }
+
+        m_heap[position]                      = m_heap[child];
+        m_nodes[m_heap[position]].heap_index = position;
+
+        position = child;
+    }
 
-    return 0;
+    m_heap[position]            = index;
+    m_nodes[index].heap_index = position;
 }
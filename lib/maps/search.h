@@ -5,43 +5,235 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "core/common.h"
+#include "maps/clearance.h"
+#include "maps/collision.h"
 #include "maps/tile.h"
 
-// A* algorithm implementation.
+class SearchHierarchy;
+
+// A* algorithm implementation over the tile grid. Movement is 8-connected (diagonal moves
+// may not cut the corner of a blocked tile) and the octile distance is used as heuristic.
+//
+// All of the per-node bookkeeping lives in flat arrays that are allocated once and reused
+// by every query: each node record is stamped with the query generation so stale records
+// from earlier searches are treated as unvisited without clearing the arrays.
+//
+// Jump Point Search can be selected per query. Since every move on the grid costs the same,
+// most paths have many symmetric variants; JPS prunes them by jumping along straight and diagonal
+// lines and only adding the points where the path may have to turn. The straight jumps scan whole
+// 64-tile words of the collision bitmap at a time (a transposed copy is used for vertical jumps).
+//
+// For long paths on large maps a hierarchical search (see SearchHierarchy) can be selected as well.
 //
-// TODO: Create implementation (currently a placeholder).
+// Agents larger than a tile are searched on a grid derived from the clearance map (see ClearanceMap):
+// a cell is walkable if the agent's square of tiles with the cell as its top left corner is free.
+// Every algorithm works on that grid unchanged, so the paths are valid for the whole agent.
 //
 // See: https://en.wikipedia.org/wiki/A*_search_algorithm#Applications
+// See: https://en.wikipedia.org/wiki/Jump_point_search
 class SearchGraph
 {
 public:
+    // The algorithm used by a query.
+    enum Algorithm
+    {
+        A_STAR,
+        JUMP_POINT,
+        HIERARCHICAL,
+    };
+
+    // The state of a query.
+    enum Status
+    {
+        SEARCHING,
+        FOUND,
+        NOT_FOUND,
+    };
+
     struct Cell
     {
         int row;
         int column;
+
+        bool operator==(const Cell& other) const = default;
     };
 
     struct Node
     {
+        uint32_t generation;
+        uint32_t cost;
         uint32_t score;
-        Cell     position;
-        uint8_t  prev;
+        int32_t  prev;
+        int32_t  heap_index;
     };
 
+    // The cost of moving to an adjacent tile.
+    static const uint32_t STRAIGHT_COST = 10;
+    static const uint32_t DIAGONAL_COST = 14;
+
 public:
     // Create a new search graph given the tile data.
     explicit SearchGraph(Tile (&tiles)[MAP_TILE_COL_COUNT * MAP_TILE_ROW_COUNT]);
 
+    // Create a new search graph with no tile data (every cell is walkable until blocked).
+    explicit SearchGraph(int rows, int columns);
+
+    // Search graph destructor.
+    ~SearchGraph();
+
 public:
-    // Find the shortest path from source to destination.
-    void find_path(Cell src, Cell dest, std::vector<Cell>& path);
+    // Rebuild the collision grid (and the search hierarchy) from the tile data.
+    void rebuild();
+
+    // Update a single cell from the tile data after the tile has changed.
+    void update(Cell cell);
+
+    // Copy the blocked cells from another collision grid (cells outside of it become blocked).
+    void assign(const CollisionGrid& collision);
+
+    // Set whether a cell is blocked.
+    void set_blocked(Cell cell, bool blocked);
+
+    // Return true if the cell is blocked.
+    bool blocked(Cell cell) const;
+
+    // Return the collision grid (the blocked tiles).
+    const CollisionGrid& collision() const;
+
+    // Return the collision grid searched for the agent (the cells the agent cannot stand on).
+    const CollisionGrid& agent_collision() const;
+
+    // Return the clearance map of the tiles.
+    const ClearanceMap& clearance() const;
+
+    // Set the size of the agent (in tiles) the paths are searched for (1 to ClearanceMap::MAX_CLEARANCE).
+    void set_agent_size(int size);
+
+    // Return the size of the agent (in tiles).
+    int agent_size() const;
+
+    // Set the maximum number of nodes expanded by a single query (0 for unlimited).
+    void set_expansion_budget(int budget);
+
+    // Return the maximum number of nodes expanded by a single query.
+    int expansion_budget() const;
+
+    // Return the number of nodes expanded by the last query.
+    int nodes_expanded() const;
+
+    // Return the number of bytes allocated for queries with an algorithm (the search hierarchy is
+    // only counted for hierarchical queries).
+    size_t memory_usage(Algorithm algorithm = A_STAR) const;
+
+    // Find the shortest path from source to destination. The path excludes the source and ends with
+    // the destination. If the destination cannot be reached (or the budget runs out) false is returned
+    // and the path leads to the visited cell closest to the destination instead. Both algorithms return
+    // every cell along the path (the hierarchical search falls back to A* for unreachable destinations
+    // and the jump point search for blocked ones).
+    bool find_path(Cell src, Cell dest, std::vector<Cell>& path, Algorithm algorithm = A_STAR);
+
+    // Start a new query, replacing the one in progress. The query is not searched until continue_search().
+    void start_search(Cell src, Cell dest, Algorithm algorithm = A_STAR);
 
-    // Calculate the cost of moving to destination.
+    // Expand up to budget nodes (0 for unlimited) of the query in progress and return its status.
+    // Queries can be split over any number of calls as long as the graph does not change in between.
+    Status continue_search(int budget);
+
+    // Return the path of the last query in the same format as find_path(). If the query is still
+    // searching the path leads to the closest cell found so far.
+    void search_path(std::vector<Cell>& path) const;
+
+    // Remove the waypoints of a path (starting from source) that the agent can walk straight past:
+    // a waypoint is only kept if the next one cannot be seen from the last waypoint kept. The last
+    // waypoint is always kept. The path is no longer made of neighboring cells afterwards.
+    void smooth_path(Cell src, std::vector<Cell>& path) const;
+
+    // Calculate the cost of moving to destination (octile distance, ignoring obstacles).
     uint32_t calculate_cost(Cell src, Cell dest) const;
 
 private:
-    Tile (&m_map_tiles)[MAP_TILE_COL_COUNT * MAP_TILE_ROW_COUNT];
+    // Return the index of a cell in the node arrays.
+    int index_of(Cell cell) const
+    {
+        return cell.row * m_agent_collision.columns() + cell.column;
+    }
+
+    // Return the cell of an index in the node arrays.
+    Cell cell_of(int index) const
+    {
+        return { index / m_agent_collision.columns(), index % m_agent_collision.columns() };
+    }
+
+    // Set whether the agent cannot stand on a cell.
+    void set_agent_blocked(Cell cell, bool blocked);
+
+    // Update the agent grid for the cells whose square of tiles covers a tile.
+    void update_agent_cells(Cell tile);
+
+    // Update the agent grid for every cell.
+    void update_agent_grid();
+
+    // Return the node record for an index, resetting it if it is from an earlier query.
+    Node& node(int index);
+
+    // Add or improve the path to the next node through the current node.
+    void relax(int current, int next, uint32_t step, Cell dest);
+
+    // Add the 8 neighbors of a node (A*).
+    void expand_neighbors(int current, Cell dest);
+
+    // Add the jump points reachable from a node (JPS).
+    void expand_jump_points(int current, Cell dest);
+
+    // Jump from a cell in a direction and return the node index of the jump point (or -1).
+    int jump(Cell cell, int dr, int dc, Cell dest) const;
+
+    // Binary heap (ordered by score) over node indices.
+    void heap_push(int index);
+    int  heap_pop();
+    void heap_decrease(int index);
+    void heap_sift_up(int position);
+    void heap_sift_down(int position);
+
+    // Follow the previous links from a node back to the source.
+    void build_path(int index, std::vector<Cell>& path) const;
+
+private:
+    // The state of the query in progress.
+    struct Query
+    {
+        Cell      src;
+        Cell      dest;
+        Algorithm algorithm;
+        Status    status;
+        int       closest;
+        uint32_t  closest_distance;
+    };
+
+private:
+    Tile* m_map_tiles;
+
+    CollisionGrid m_collision;
+    ClearanceMap  m_clearance;
+    int           m_agent_size;
+
+    // The cells the agent cannot stand on (and a transposed copy for vertical jumps).
+    CollisionGrid m_agent_collision;
+    CollisionGrid m_transposed;
+
+    std::unique_ptr<SearchHierarchy> m_hierarchy;
+    std::vector<Cell>                m_hierarchy_path;
+
+    Query m_query;
+
+    std::vector<Node> m_nodes;
+    std::vector<int>  m_heap;
+
+    uint32_t m_generation;
+    int      m_expansion_budget;
+    int      m_nodes_expanded;
 };
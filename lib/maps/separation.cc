@@ -0,0 +1,203 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "maps/separation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "core/common.h"
+
+// The radius (in pixels) of the circle an entity takes up (half the width of its bounding box).
+static const float RADIUS = MAP_TILE_SIZE / 2.0f;
+
+// The closest two entity centers can be (well under the size of a bucket).
+static const float MIN_DISTANCE = RADIUS * 2;
+
+// The number of buckets in the grid.
+static const int BUCKET_COUNT = SpatialGrid::COL_COUNT * SpatialGrid::ROW_COUNT;
+
+// The buckets after a bucket (right, below left, below and below right).
+static const int NEIGHBORS[][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+
+Separation::Separation(int budget)
+  : m_budget(budget)
+  , m_next_bucket(0)
+  , m_stats()
+{
+}
+
+void Separation::resolve(const SpatialGrid& grid, const CollisionGrid& walls, Components& components,
+                         std::vector<Entity*>& moved)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    m_stats = {};
+    moved.clear();
+
+    // Take a sorted copy of the buckets (the entities only change buckets after the pass).
+    m_offsets.resize(BUCKET_COUNT + 1);
+    m_entities.clear();
+
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        m_offsets[i] = m_entities.size();
+
+        for (auto entity : grid.bucket(i)) {
+            if (!entity->dead() && components.detail.tier[entity->component_index()] != Components::DORMANT) {
+                m_entities.push_back(entity);
+            }
+        }
+
+        std::sort(m_entities.begin() + m_offsets[i], m_entities.end(), [](const auto a, const auto b) {
+            return a->handle().index < b->handle().index;
+        });
+    }
+
+    m_offsets[BUCKET_COUNT] = m_entities.size();
+
+    auto visited = 0;
+
+    for (; visited < BUCKET_COUNT; ++visited) {
+        const auto bucket = static_cast<int>((m_next_bucket + visited) % BUCKET_COUNT);
+        const auto begin  = m_offsets[bucket];
+        const auto end    = m_offsets[bucket + 1];
+
+        if (begin == end) {
+            continue;
+        }
+
+        const auto column = bucket % SpatialGrid::COL_COUNT;
+        const auto row    = bucket / SpatialGrid::COL_COUNT;
+
+        // Count the pairs first so that a bucket is either done or left for the next frame.
+        int neighbors[4];
+        int neighbor_count = 0;
+        int pairs          = (end - begin) * (end - begin - 1) / 2;
+
+        for (const auto& offset : NEIGHBORS) {
+            const auto c = column + offset[0];
+            const auto r = row + offset[1];
+
+            if (c < 0 || c >= SpatialGrid::COL_COUNT || r >= SpatialGrid::ROW_COUNT) {
+                continue;
+            }
+
+            const auto neighbor = c + r * SpatialGrid::COL_COUNT;
+
+            neighbors[neighbor_count++] = neighbor;
+            pairs += (end - begin) * (m_offsets[neighbor + 1] - m_offsets[neighbor]);
+        }
+
+        if (m_stats.pair_tests > 0 && m_stats.pair_tests + pairs > m_budget) {
+            m_stats.exhausted = true;
+            break;
+        }
+
+        separate(begin, end, begin, end, walls, components, moved);
+
+        for (int i = 0; i < neighbor_count; ++i) {
+            const auto neighbor = neighbors[i];
+
+            separate(begin, end, m_offsets[neighbor], m_offsets[neighbor + 1], walls, components, moved);
+        }
+
+        ++m_stats.buckets;
+    }
+
+    // Start over once every bucket has been visited.
+    m_next_bucket = m_stats.exhausted ? (m_next_bucket + visited) % BUCKET_COUNT : 0;
+
+    m_stats.resolve_us =
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int Separation::budget() const
+{
+    return m_budget;
+}
+
+void Separation::set_budget(int budget)
+{
+    m_budget = budget;
+}
+
+const Separation::Stats& Separation::stats() const
+{
+    return m_stats;
+}
+
+void Separation::separate(uint32_t a_begin, uint32_t a_end, uint32_t b_begin, uint32_t b_end,
+                          const CollisionGrid& walls, Components& components, std::vector<Entity*>& moved)
+{
+    const auto same = a_begin == b_begin;
+
+    for (auto i = a_begin; i < a_end; ++i) {
+        for (auto j = same ? i + 1 : b_begin; j < b_end; ++j) {
+            const auto a = m_entities[i];
+            const auto b = m_entities[j];
+
+            ++m_stats.pair_tests;
+
+            auto dx = b->center_x() - a->center_x();
+            auto dy = b->center_y() - a->center_y();
+
+            const auto distance = std::hypot(dx, dy);
+
+            if (distance >= MIN_DISTANCE) {
+                continue;
+            }
+
+            ++m_stats.overlaps;
+
+            // Standing on the same spot, split them sideways (in handle order).
+            if (distance > 0.0f) {
+                dx /= distance;
+                dy /= distance;
+            } else {
+                dx = 1.0f;
+                dy = 0.0f;
+            }
+
+            const auto overlap = MIN_DISTANCE - distance;
+
+            // The player holds its ground.
+            const auto a_share = a->is_player() ? 0.0f : (b->is_player() ? 1.0f : 0.5f);
+            const auto b_share = 1.0f - a_share;
+
+            if (a_share > 0.0f && push(a, -dx * overlap * a_share, -dy * overlap * a_share, walls, components)) {
+                moved.push_back(a);
+            }
+
+            if (b_share > 0.0f && push(b, dx * overlap * b_share, dy * overlap * b_share, walls, components)) {
+                moved.push_back(b);
+            }
+        }
+    }
+}
+
+bool Separation::push(Entity* entity, float dx, float dy, const CollisionGrid& walls, Components& components)
+{
+    const auto i = entity->component_index();
+
+    auto& motion = components.motion;
+
+    const auto x = std::clamp(motion.position_x[i] + dx, 0.0f, static_cast<float>(MAP_WIDTH - CHARACTER_WIDTH));
+    const auto y = std::clamp(motion.position_y[i] + dy, 0.0f, static_cast<float>(MAP_HEIGHT - CHARACTER_HEIGHT));
+
+    // The same footprint as the paths (the feet must not end up in a wall).
+    if (const auto cell = Entity::cell_at(x, y); walls.blocked(cell.row, cell.column)) {
+        return false;
+    }
+
+    // The height follows the ground (even in the middle of a jump).
+    motion.position_z[i] += y - motion.position_y[i];
+    motion.position_x[i] = x;
+    motion.position_y[i] = y;
+
+    ++m_stats.pushes;
+
+    return true;
+}
@@ -0,0 +1,81 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "characters/components.h"
+#include "characters/entity.h"
+#include "maps/collision.h"
+#include "maps/spatial.h"
+
+// Separation pushes apart the entities that overlap. Every entity is a circle around its center
+// and the spatial grid is the broadphase: the buckets are much larger than the circles, so a pair
+// can only overlap if both entities are in the same or in neighbouring buckets. Each pair of
+// buckets is visited once (a bucket with itself and with the buckets to its right and below).
+//
+// The buckets are visited in row order and the entities of a bucket in handle order, so the
+// same positions always give the same result. The player is never pushed (the enemies make room
+// instead) and the dead and dormant entities are left where they are.
+//
+// At most a fixed number of pairs is tested per frame. Once the budget runs out, the next frame
+// picks up at the bucket where this one stopped.
+class Separation
+{
+public:
+    // The number of pairs tested per frame by default.
+    static const int DEFAULT_BUDGET = 4096;
+
+    // Counters from the last frame.
+    struct Stats
+    {
+        int    buckets;
+        int    pair_tests;
+        int    overlaps;
+        int    pushes;
+        bool   exhausted;
+        double resolve_us;
+    };
+
+public:
+    // Create the separation pass with a budget of pair tests per frame.
+    explicit Separation(int budget = DEFAULT_BUDGET);
+
+public:
+    // Push apart the overlapping entities of the grid. The walls are the cells the path agent cannot
+    // stand on and no entity is pushed onto one. The entities that were moved are written to moved
+    // (cleared first) so that the caller can update the grid once the pass is over.
+    void resolve(const SpatialGrid& grid, const CollisionGrid& walls, Components& components,
+                 std::vector<Entity*>& moved);
+
+    // Return the number of pairs tested per frame.
+    int budget() const;
+
+    // Set the number of pairs tested per frame (at least one bucket is always visited).
+    void set_budget(int budget);
+
+    // Return the counters from the last frame.
+    const Stats& stats() const;
+
+private:
+    // Test every pair within the entities of a bucket (a and b are the same) or between the
+    // entities of two buckets.
+    void separate(uint32_t a_begin, uint32_t a_end, uint32_t b_begin, uint32_t b_end, const CollisionGrid& walls,
+                  Components& components, std::vector<Entity*>& moved);
+
+    // Move an entity unless the tile it would stand on is a wall.
+    bool push(Entity* entity, float dx, float dy, const CollisionGrid& walls, Components& components);
+
+private:
+    int      m_budget;
+    uint32_t m_next_bucket;
+    Stats    m_stats;
+
+    // The entities of every bucket sorted by handle (bucket i is m_offsets[i] to m_offsets[i + 1]).
+    std::vector<uint32_t> m_offsets;
+    std::vector<Entity*>  m_entities;
+};
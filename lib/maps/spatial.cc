@@ -0,0 +1,123 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "maps/spatial.h"
+
+SpatialGrid::SpatialGrid()
+{
+}
+
+int SpatialGrid::column_of(float x)
+{
+    return std::clamp(static_cast<int>(x) / CELL_SIZE, 0, COL_COUNT - 1);
+}
+
+int SpatialGrid::row_of(float y)
+{
+    return std::clamp(static_cast<int>(y) / CELL_SIZE, 0, ROW_COUNT - 1);
+}
+
+void SpatialGrid::insert(Entity* entity)
+{
+    const auto cell = column_of(entity->center_x()) + row_of(entity->center_y()) * COL_COUNT;
+
+    m_cells[cell].push_back(entity);
+    entity->set_grid_cell(cell);
+}
+
+void SpatialGrid::remove(Entity* entity)
+{
+    if (entity->grid_cell() < 0) {
+        return;
+    }
+
+    auto& bucket = m_cells[entity->grid_cell()];
+
+    // Buckets are unordered so we can swap with the last entity instead of shifting.
+    if (auto iter = std::find(bucket.begin(), bucket.end(), entity); iter != bucket.end()) {
+        *iter = bucket.back();
+        bucket.pop_back();
+    }
+
+    entity->set_grid_cell(-1);
+}
+
+void SpatialGrid::move(Entity* entity)
+{
+    const auto cell = column_of(entity->center_x()) + row_of(entity->center_y()) * COL_COUNT;
+
+    if (cell == entity->grid_cell()) {
+        return;
+    }
+
+    remove(entity);
+
+    m_cells[cell].push_back(entity);
+    entity->set_grid_cell(cell);
+}
+
+void SpatialGrid::clear()
+{
+    for (auto& bucket : m_cells) {
+        for (auto entity : bucket) {
+            entity->set_grid_cell(-1);
+        }
+
+        bucket.clear();
+    }
+}
+
+const std::vector<Entity*>& SpatialGrid::bucket(int index) const
+{
+    return m_cells[index];
+}
+
+void SpatialGrid::query_rect(const SDL_Rect& rect, std::vector<Entity*>& result) const
+{
+    result.clear();
+
+    const auto min_col = column_of(rect.x);
+    const auto max_col = column_of(rect.x + rect.w);
+    const auto min_row = row_of(rect.y);
+    const auto max_row = row_of(rect.y + rect.h);
+
+    for (int row = min_row; row <= max_row; ++row) {
+        for (int col = min_col; col <= max_col; ++col) {
+            for (auto entity : m_cells[col + row * COL_COUNT]) {
+                const auto x = entity->center_x();
+                const auto y = entity->center_y();
+
+                if (x >= rect.x && x < rect.x + rect.w && y >= rect.y && y < rect.y + rect.h) {
+                    result.push_back(entity);
+                }
+            }
+        }
+    }
+}
+
+void SpatialGrid::query_radius(float x, float y, float radius, std::vector<Entity*>& result) const
+{
+    result.clear();
+
+    const auto min_col = column_of(x - radius);
+    const auto max_col = column_of(x + radius);
+    const auto min_row = row_of(y - radius);
+    const auto max_row = row_of(y + radius);
+
+    const auto radius_squared = radius * radius;
+
+    for (int row = min_row; row <= max_row; ++row) {
+        for (int col = min_col; col <= max_col; ++col) {
+            for (auto entity : m_cells[col + row * COL_COUNT]) {
+                const auto dx = entity->center_x() - x;
+                const auto dy = entity->center_y() - y;
+
+                if (dx * dx + dy * dy <= radius_squared) {
+                    result.push_back(entity);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,166 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "characters/entity.h"
+#include "core/common.h"
+
+// SpatialGrid is a uniform grid of buckets covering the whole map. Entities are binned by
+// their center point so that proximity queries only visit the buckets that overlap the
+// query area instead of every entity on the map.
+class SpatialGrid
+{
+public:
+    // The size of a single bucket (in pixels).
+    static const int CELL_SIZE = MAP_TILE_SIZE * 4;
+
+    // The number of buckets in each direction.
+    static const int COL_COUNT = (MAP_WIDTH + CELL_SIZE - 1) / CELL_SIZE;
+    static const int ROW_COUNT = (MAP_HEIGHT + CELL_SIZE - 1) / CELL_SIZE;
+
+public:
+    // Create a new empty grid.
+    explicit SpatialGrid();
+
+public:
+    // Add an entity to the grid.
+    void insert(Entity* entity);
+
+    // Remove an entity from the grid.
+    void remove(Entity* entity);
+
+    // Move an entity to another bucket if its position has changed buckets.
+    void move(Entity* entity);
+
+    // Remove all entities from the grid.
+    void clear();
+
+    // Return the entities of a bucket (column + row * COL_COUNT) in no particular order.
+    const std::vector<Entity*>& bucket(int index) const;
+
+    // Find all entities whose center lies inside the rectangle. The result buffer is cleared first.
+    void query_rect(const SDL_Rect& rect, std::vector<Entity*>& result) const;
+
+    // Find all entities whose center lies within the radius of a point. The result buffer is cleared first.
+    void query_radius(float x, float y, float radius, std::vector<Entity*>& result) const;
+
+    // Find up to k entities closest to a point (within the radius) that are accepted by the filter. The
+    // result buffer is cleared first and is sorted from nearest to farthest.
+    template<typename Filter>
+    void nearest(float x, float y, float radius, size_t k, Filter filter, std::vector<Entity*>& result) const;
+
+    // Find the entity closest to a point (within the radius) that is accepted by the filter.
+    template<typename Filter>
+    Entity* nearest(float x, float y, float radius, Filter filter) const;
+
+private:
+    // The maximum number of entities returned by nearest().
+    static const size_t MAX_NEAREST = 16;
+
+    // Write up to k (at most MAX_NEAREST) nearest entities into the result array and return the count.
+    template<typename Filter>
+    size_t find_nearest(float x, float y, float radius, size_t k, Filter filter, Entity** result) const;
+
+    // Return the bucket column/row for a pixel coordinate (clamped to the grid).
+    static int column_of(float x);
+    static int row_of(float y);
+
+private:
+    std::vector<Entity*> m_cells[COL_COUNT * ROW_COUNT];
+};
+
+template<typename Filter>
+void SpatialGrid::nearest(float x, float y, float radius, size_t k, Filter filter, std::vector<Entity*>& result) const
+{
+    result.resize(std::min(k, MAX_NEAREST));
+    result.resize(find_nearest(x, y, radius, result.size(), filter, result.data()));
+}
+
+template<typename Filter>
+Entity* SpatialGrid::nearest(float x, float y, float radius, Filter filter) const
+{
+    Entity* result = nullptr;
+    find_nearest(x, y, radius, 1, filter, &result);
+    return result;
+}
+
+template<typename Filter>
+size_t SpatialGrid::find_nearest(float x, float y, float radius, size_t k, Filter filter, Entity** result) const
+{
+    // Squared distances of the entities in the result (kept in the same order).
+    float  distances[MAX_NEAREST];
+    float  worst = radius * radius;
+    size_t count = 0;
+
+    if (k == 0) {
+        return 0;
+    }
+
+    const auto col = column_of(x);
+    const auto row = row_of(y);
+
+    const auto max_ring = static_cast<int>(radius / CELL_SIZE) + 1;
+
+    // Visit the buckets in rings around the origin so that we can stop as soon as the
+    // closest point of the next ring is farther away than the worst accepted result.
+    for (int ring = 0; ring <= max_ring; ++ring) {
+        if (ring > 1) {
+            const auto gap = static_cast<float>((ring - 1) * CELL_SIZE);
+
+            if (gap * gap > worst) {
+                break;
+            }
+        }
+
+        for (int r = row - ring; r <= row + ring; ++r) {
+            if (r < 0 || r >= ROW_COUNT) {
+                continue;
+            }
+
+            // Only the border of the ring is new; the inside was visited by the previous rings.
+            const auto step = (r == row - ring || r == row + ring) ? 1 : std::max(1, ring * 2);
+
+            for (int c = col - ring; c <= col + ring; c += step) {
+                if (c < 0 || c >= COL_COUNT) {
+                    continue;
+                }
+
+                for (auto entity : m_cells[c + r * COL_COUNT]) {
+                    const auto dx = entity->center_x() - x;
+                    const auto dy = entity->center_y() - y;
+                    const auto d  = dx * dx + dy * dy;
+
+                    if (d > worst || (count == k && d >= worst) || !filter(entity)) {
+                        continue;
+                    }
+
+                    // Insert in distance order, dropping the farthest when full.
+                    auto i = count == k ? k - 1 : count++;
+
+                    while (i > 0 && distances[i - 1] > d) {
+                        result[i]    = result[i - 1];
+                        distances[i] = distances[i - 1];
+                        --i;
+                    }
+
+                    result[i]    = entity;
+                    distances[i] = d;
+
+                    if (count == k) {
+                        worst = distances[k - 1];
+                    }
+                }
+            }
+        }
+    }
+
+    return count;
+}
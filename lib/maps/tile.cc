@@ -58,6 +58,23 @@ bool Tile::has_fg() const
     return fg() >= 0;
 }
 
+bool Tile::is_solid() const
+{
+    switch (fg()) {
+    case SMALL_GOLD_BAR_1:
+    case SMALL_GOLD_BAR_2:
+    case SMALL_GOLD_BAR_3:
+    case SMALL_GOLD_BAR_4:
+    case SMALL_GOLD_BAR_5:
+    case BIG_GOLD_BAR_1:
+    case BIG_GOLD_BAR_2:
+    case BIG_GOLD_BAR_3:
+        return false;
+    default:
+        return has_fg();
+    }
+}
+
 void Tile::set_layer(Layer layer, int value)
 {
     m_layers[layer] = value;
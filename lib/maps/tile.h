@@ -66,6 +66,9 @@ public:
     // Return true if foreground layer exists.
     bool has_fg() const;
 
+    // Return true if the foreground blocks movement (items that can be picked up do not).
+    bool is_solid() const;
+
     // Set the id for a layer.
     void set_layer(Layer layer, int value);
 
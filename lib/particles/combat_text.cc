@@ -0,0 +1,210 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#include "particles/combat_text.h"
+
+#include <SDL_ttf.h>
+
+#include <algorithm>
+#include <charconv>
+
+#include "core/game.h"
+
+// The characters of the atlas glyphs (in order).
+static const char GLYPHS[] = "0123456789+-!";
+
+static_assert(sizeof(GLYPHS) - 1 == CombatText::GLYPH_COUNT);
+
+// How long (in milliseconds) a number stays on screen.
+static const uint32_t LIFETIME = 280;
+
+// How far (in pixels) a number floats up before it disappears.
+static const float RISE_HEIGHT = 25.0f;
+
+// Return the atlas index of a character or -1 if it has no glyph.
+static int glyph_index(char c)
+{
+    for (size_t i = 0; i < CombatText::GLYPH_COUNT; ++i) {
+        if (GLYPHS[i] == c) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+CombatText::CombatText(Game& game)
+  : m_game(game)
+  , m_clips()
+  , m_glyph_height(0)
+  , m_numbers()
+  , m_first(0)
+  , m_count(0)
+{
+}
+
+bool CombatText::initialize()
+{
+    std::array<SDL_Surface*, GLYPH_COUNT> glyphs;
+
+    int width = 0;
+
+    m_glyph_height = 0;
+
+    for (size_t i = 0; i < GLYPH_COUNT; ++i) {
+        const char text[] = { GLYPHS[i], '\0' };
+
+        glyphs[i] = TTF_RenderText_Blended(m_game.font(), text, { 255, 255, 255, 255 });
+
+        if (glyphs[i] == nullptr) {
+            LOG_ERROR << "Failed to render glyph: " << TTF_GetError() << std::endl;
+
+            for (size_t j = 0; j < i; ++j) {
+                SDL_FreeSurface(glyphs[j]);
+            }
+
+            return false;
+        }
+
+        m_clips[i] = { width, 0, glyphs[i]->w, glyphs[i]->h };
+
+        width += glyphs[i]->w;
+        m_glyph_height = std::max(m_glyph_height, glyphs[i]->h);
+    }
+
+    // Lay the glyphs out side by side (copying their alpha as is rather than blending it).
+    auto atlas = SDL_CreateRGBSurfaceWithFormat(0, width, m_glyph_height, 32, SDL_PIXELFORMAT_RGBA32);
+
+    if (atlas != nullptr) {
+        for (size_t i = 0; i < GLYPH_COUNT; ++i) {
+            auto dest = m_clips[i];
+
+            SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(glyphs[i], nullptr, atlas, &dest);
+        }
+    } else {
+        LOG_ERROR << "Failed to create glyph atlas: " << SDL_GetError() << std::endl;
+    }
+
+    for (auto glyph : glyphs) {
+        SDL_FreeSurface(glyph);
+    }
+
+    if (atlas == nullptr) {
+        return false;
+    }
+
+    const auto loaded = m_atlas.load_from_surface(m_game.window.renderer(), atlas);
+
+    SDL_FreeSurface(atlas);
+
+    if (!loaded) {
+        LOG_ERROR << "Failed to load glyph atlas" << std::endl;
+        return false;
+    }
+
+    m_atlas.set_blend_mode(SDL_BLENDMODE_BLEND);
+
+    return true;
+}
+
+void CombatText::add(int value, float x, float y, float scale, float rotation)
+{
+    char text[MAX_LENGTH];
+
+    const auto result = std::to_chars(text, text + MAX_LENGTH, value);
+
+    add(std::string_view(text, result.ptr - text), x, y, scale, rotation);
+}
+
+void CombatText::add(std::string_view text, float x, float y, float scale, float rotation)
+{
+    // Full, make room by dropping the oldest number.
+    if (m_count == CAPACITY) {
+        m_first = (m_first + 1) % CAPACITY;
+        --m_count;
+    }
+
+    auto& number = m_numbers[(m_first + m_count) % CAPACITY];
+
+    number.x        = x;
+    number.y        = y;
+    number.scale    = scale;
+    number.rotation = rotation;
+    number.age      = 0;
+    number.length   = 0;
+    number.width    = 0;
+    number.alpha    = 255;
+    number.rise     = 0.0f;
+
+    for (auto c : text) {
+        if (const auto glyph = glyph_index(c); glyph >= 0 && number.length < MAX_LENGTH) {
+            number.glyphs[number.length++] = glyph;
+            number.width += m_clips[glyph].w;
+        }
+    }
+
+    ++m_count;
+}
+
+void CombatText::update(uint32_t ticks)
+{
+    for (size_t i = 0; i < m_count; ++i) {
+        auto& number = m_numbers[(m_first + i) % CAPACITY];
+
+        number.age   = std::min(number.age + ticks, LIFETIME);
+        number.alpha = 255 - number.age * 255 / LIFETIME;
+        number.rise  = RISE_HEIGHT * number.age / LIFETIME;
+    }
+
+    // The oldest numbers are at the front.
+    while (m_count > 0 && m_numbers[m_first].age >= LIFETIME) {
+        m_first = (m_first + 1) % CAPACITY;
+        --m_count;
+    }
+}
+
+void CombatText::render(const SDL_Rect& camera)
+{
+    for (size_t i = 0; i < m_count; ++i) {
+        const auto& number = m_numbers[(m_first + i) % CAPACITY];
+
+        const auto width  = number.width * number.scale;
+        const auto height = m_glyph_height * number.scale;
+
+        // The top left corner of the number on screen.
+        const auto left = number.x - width / 2 - camera.x;
+        const auto top  = number.y - number.rise - camera.y;
+
+        // Skip numbers that are completely off-screen (leaving room for the rotation).
+        if (left + width + height < 0 || left - height > camera.w || top + width < 0 || top - width > camera.h) {
+            continue;
+        }
+
+        m_atlas.set_alpha(number.alpha);
+
+        auto x = left;
+
+        for (size_t j = 0; j < number.length; ++j) {
+            const auto& clip = m_clips[number.glyphs[j]];
+
+            const SDL_Rect dest = { static_cast<int>(x), static_cast<int>(top), static_cast<int>(clip.w * number.scale),
+                                    static_cast<int>(clip.h * number.scale) };
+
+            // Every glyph turns around the center of the whole number.
+            const SDL_Point center = { static_cast<int>(left + width / 2) - dest.x,
+                                       static_cast<int>(top + height / 2) - dest.y };
+
+            m_atlas.render_transform(&clip, dest, number.rotation, &center);
+
+            x += clip.w * number.scale;
+        }
+    }
+}
+
+size_t CombatText::size() const
+{
+    return m_count;
+}
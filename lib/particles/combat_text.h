@@ -0,0 +1,94 @@
+// Copyright (c) 2022 Kaiyan M. Lee
+//
+// Jasmine is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License v3.0.
+
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "graphics/texture.h"
+
+class Game;
+
+// CombatText draws the numbers floating up from the entities that get hit.
+//
+// The digits (and a few symbols) are rasterized once into a glyph atlas when the game starts, so
+// showing a number only fills a slot of a fixed pool and drawing it is a few copies out of one
+// texture. Every number lives for the same time, so the pool is a ring: new numbers go at the
+// back, expired ones leave from the front and once it is full the oldest number makes room.
+class CombatText
+{
+public:
+    // The number of numbers on screen at once.
+    static const size_t CAPACITY = 256;
+
+    // The most glyphs in a number.
+    static const size_t MAX_LENGTH = 12;
+
+    // The glyphs in the atlas: the digits, '+', '-' and '!'.
+    static const size_t GLYPH_COUNT = 13;
+
+public:
+    // Create the combat text of the game.
+    explicit CombatText(Game& game);
+
+public:
+    // Build the glyph atlas. Only needs to be called once (after the font is loaded).
+    bool initialize();
+
+    // Show a number with its top center at the given position on the map (in pixels). The number
+    // is drawn scaled and rotated (in degrees) around its center.
+    void add(int value, float x, float y, float scale, float rotation);
+
+    // Show a text made of the atlas glyphs (any other character is left out).
+    void add(std::string_view text, float x, float y, float scale, float rotation);
+
+    // Fade out and raise every number and drop the expired ones.
+    void update(uint32_t ticks);
+
+    // Render the numbers.
+    void render(const SDL_Rect& camera);
+
+    // Return the number of numbers showing.
+    size_t size() const;
+
+private:
+    struct Number
+    {
+        // The top center of the number on the map.
+        float x;
+        float y;
+
+        float scale;
+        float rotation;
+
+        // The time (in milliseconds) since the number was added.
+        uint32_t age;
+
+        // The glyphs (atlas indices) and their total width (unscaled).
+        std::array<uint8_t, MAX_LENGTH> glyphs;
+        uint8_t                         length;
+        int                             width;
+
+        // Updated every frame from the age.
+        uint8_t alpha;
+        float   rise;
+    };
+
+private:
+    Game&   m_game;
+    Texture m_atlas;
+
+    // The clip of each glyph in the atlas.
+    std::array<SDL_Rect, GLYPH_COUNT> m_clips;
+    int                               m_glyph_height;
+
+    std::array<Number, CAPACITY> m_numbers;
+    size_t                       m_first;
+    size_t                       m_count;
+};
@@ -9,6 +9,8 @@
 
 Emitter::Emitter(Game& game)
   : m_game(game)
+  , m_drawn_count(0)
+  , m_culled_count(0)
 {
     m_clips[Particle::Effect::GAS]          = split(70, 6, 6 * 5);
     m_clips[Particle::Effect::MAGIC_CIRCLE] = split(32, 5, 8 * 5);
@@ -123,31 +125,40 @@ void Emitter::render(const SDL_Rect& camera)
 {
     SDL_Rect rect;
 
+    m_drawn_count  = 0;
+    m_culled_count = 0;
+
     for (const auto& sequence : m_sequences) {
         for (const auto& particle : sequence.particles) {
+            rect.x = particle.position.x - SPRITE_SIZE / 2;
+            rect.y = particle.position.y - SPRITE_SIZE / 2;
+            rect.w = SPRITE_SIZE;
+            rect.h = SPRITE_SIZE;
+
+            // Skip particles that are completely off-screen.
+            if (!SDL_HasIntersection(&rect, &camera)) {
+                ++m_culled_count;
+                continue;
+            }
 
-            // rect.x = (particle.position.x - camera.x) - MAP_TILE_SIZE / 2;
-            // rect.y = (particle.position.y - camera.y);
-
-            // rect.w = MAP_TILE_SIZE;
-            // rect.h = MAP_TILE_SIZE;
-
-            // SDL_SetRenderDrawBlendMode(m_game.window.renderer(), SDL_BLENDMODE_BLEND);
-
-            // SDL_SetRenderDrawColor(m_game.window.renderer(), 255, 0, 0, 50);
-            // SDL_RenderFillRect(m_game.window.renderer(), &rect);
+            m_texture.render(rect.x - camera.x, rect.y - camera.y, &m_clips[particle.effect][particle.frame]);
 
-            m_texture.render((particle.position.x - SPRITE_SIZE / 2) - camera.x,
-                             (particle.position.y - SPRITE_SIZE / 2) - camera.y,
-                             &m_clips[particle.effect][particle.frame]);
+            ++m_drawn_count;
         }
 
-        rect.x = (sequence.destination.x - camera.x) - MAP_TILE_SIZE / 2;
-        rect.y = (sequence.destination.y - camera.y);
+        rect.x = sequence.destination.x - MAP_TILE_SIZE / 2;
+        rect.y = sequence.destination.y;
 
         rect.w = MAP_TILE_SIZE;
         rect.h = MAP_TILE_SIZE;
 
+        if (!SDL_HasIntersection(&rect, &camera)) {
+            continue;
+        }
+
+        rect.x -= camera.x;
+        rect.y -= camera.y;
+
         SDL_SetRenderDrawBlendMode(m_game.window.renderer(), SDL_BLENDMODE_BLEND);
 
         SDL_SetRenderDrawColor(m_game.window.renderer(), 255, 0, 0, 50);
@@ -155,6 +166,16 @@ void Emitter::render(const SDL_Rect& camera)
     }
 }
 
+int Emitter::drawn_count() const
+{
+    return m_drawn_count;
+}
+
+int Emitter::culled_count() const
+{
+    return m_culled_count;
+}
+
 Emitter::~Emitter()
 {
 }
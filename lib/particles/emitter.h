@@ -37,6 +37,12 @@ public:
 
     void update(uint32_t ticks);
 
+    // Return the number of particles drawn during the last render.
+    int drawn_count() const;
+
+    // Return the number of off-screen particles skipped during the last render.
+    int culled_count() const;
+
 private:
     static const auto SPRITESHEET_COLUMNS = 6;
     static const auto SPRITESHEET_ROWS    = 75;
@@ -65,4 +71,7 @@ private:
 
     std::vector<SDL_Rect>         m_clips[ANIMATION_COUNT];
     std::vector<ParticleSequence> m_sequences;
+
+    int m_drawn_count;
+    int m_culled_count;
 };
@@ -3,12 +3,20 @@
 // Jasmine is free software: you can redistribute it and/or modify
 // it under the terms of the GNU General Public License v3.0.
 
+#include "characters/benchmark.h"
 #include "core/game.h"
 #include "core/logger.h"
+#include "core/stress.h"
+#include "maps/benchmark.h"
 
 int main(int argc, char** argv)
 {
-    int frame_rate = 30;
+    int  frame_rate         = 30;
+    bool benchmark_search   = false;
+    bool benchmark_movement = false;
+    bool stress             = false;
+    int  stress_enemies     = StressTest::DEFAULT_ENEMIES;
+    int  stress_frames      = StressTest::DEFAULT_FRAMES;
 
     while (argc > 1) {
         if (const auto a = argv[--argc]; strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0) {
@@ -31,6 +39,12 @@ int main(int argc, char** argv)
             puts("  --slow             Render at 15 fps.");
             puts("  --fast             Render at 60 fps.");
             puts("");
+            puts("  --benchmark-search   Run the path search benchmarks and print the results as JSON.");
+            puts("  --benchmark-movement Run the movement benchmarks and print the results as JSON.");
+            puts("");
+            puts("  --stress [enemies=N] [frames=N]");
+            puts("                     Fill the level with N enemies, run N frames and print the frame times as JSON.");
+            puts("");
             return EXIT_SUCCESS;
         } else if (strcmp(a, "--version") == 0 || strcmp(a, "-v") == 0) {
             puts("0.0.1");
@@ -39,16 +53,42 @@ int main(int argc, char** argv)
             frame_rate = 15;
         } else if (strcmp(a, "--fast") == 0) {
             frame_rate = 60;
+        } else if (strcmp(a, "--benchmark-search") == 0) {
+            benchmark_search = true;
+        } else if (strcmp(a, "--benchmark-movement") == 0) {
+            benchmark_movement = true;
+        } else if (strcmp(a, "--stress") == 0) {
+            stress = true;
+        } else if (strncmp(a, "enemies=", 8) == 0 && atoi(a + 8) > 0) {
+            stress_enemies = atoi(a + 8);
+        } else if (strncmp(a, "frames=", 7) == 0 && atoi(a + 7) > 0) {
+            stress_frames = atoi(a + 7);
         } else {
             printf("Unknown command-line option: %s\n", a);
             return EXIT_FAILURE;
         }
     }
 
+    if (benchmark_search) {
+        SearchBenchmark benchmark;
+
+        return benchmark.run(std::cout) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if (benchmark_movement) {
+        MovementBenchmark benchmark;
+
+        return benchmark.run(std::cout) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     Game game;
     game.set_frame_rate(frame_rate);
     game.set_app_name("Jasmine");
 
+    if (stress) {
+        game.set_stress_test(stress_enemies, stress_frames);
+    }
+
     if (!game.initialize()) {
         LOG_ERROR << "Failed to initialize game object. Exiting..." << std::endl;
         return EXIT_FAILURE;